@@ -0,0 +1,142 @@
+#include "editor.h"
+
+//Row memory of the document: chars, highLight and tabs
+//Blocks up to ARENA_MAX bytes come in size classes of ARENA_STEP bytes, carved out of big chunks
+//and kept on a free list per class once freed; larger ones are malloc'ed and linked in a list
+//Either way arenaFreeAll() gives back the whole document at once, without looking at its rows
+
+#define ARENA_CHUNK (1 << 20)
+
+//Header of a block bigger than ARENA_MAX, keeps the block after it aligned
+struct arenaBlock
+{
+	struct arenaBlock *next;
+	struct arenaBlock *prev;
+};
+
+int arenaClass(size_t size)
+{
+	return (size + ARENA_STEP - 1) / ARENA_STEP - 1;
+}
+
+//Returns a block of at least "size" bytes, NULL for 0
+void *arenaAlloc(size_t size)
+{
+	struct rowArena *arena = &Editor.arena;
+	if(size == 0)
+		return NULL;
+
+	if(size > ARENA_MAX)
+	{
+		struct arenaBlock *block = malloc(sizeof(struct arenaBlock) + size);
+		if(block == NULL)
+			die("malloc");
+		block->prev = NULL;
+		block->next = arena->large;
+		if(arena->large)
+			arena->large->prev = block;
+		arena->large = block;
+		return block + 1;
+	}
+
+	int class = arenaClass(size);
+	size = (class + 1) * ARENA_STEP;
+	void *block = arena->free[class];
+	if(block)
+	{
+		arena->free[class] = *(void **)block;
+		return block;
+	}
+
+	if(arena->next + size > arena->end)		//the rest of the chunk is left unused
+	{
+		char *chunk = malloc(ARENA_CHUNK);
+		if(chunk == NULL)
+			die("malloc");
+		*(char **)chunk = arena->chunks;
+		arena->chunks = chunk;
+		arena->next = chunk + ARENA_STEP;
+		arena->end = chunk + ARENA_CHUNK;
+	}
+	block = arena->next;
+	arena->next += size;
+	return block;
+}
+
+//"size" is what the block was asked for with
+void arenaFree(void *p, size_t size)
+{
+	struct rowArena *arena = &Editor.arena;
+	if(p == NULL)
+		return;
+
+	if(size > ARENA_MAX)
+	{
+		struct arenaBlock *block = (struct arenaBlock *)p - 1;
+		if(block->prev)
+			block->prev->next = block->next;
+		else
+			arena->large = block->next;
+		if(block->next)
+			block->next->prev = block->prev;
+		free(block);
+		return;
+	}
+
+	int class = arenaClass(size);
+	*(void **)p = arena->free[class];
+	arena->free[class] = p;
+}
+
+//Like realloc(), a block that stays in its class is not moved
+void *arenaResize(void *p, size_t size, size_t newSize)
+{
+	if(p == NULL)
+		return arenaAlloc(newSize);
+	if(newSize == 0)
+	{
+		arenaFree(p, size);
+		return NULL;
+	}
+	if(size <= ARENA_MAX && newSize <= ARENA_MAX && arenaClass(size) == arenaClass(newSize))
+		return p;
+
+	if(size > ARENA_MAX && newSize > ARENA_MAX)
+	{
+		struct rowArena *arena = &Editor.arena;
+		struct arenaBlock *block = realloc((struct arenaBlock *)p - 1, sizeof(struct arenaBlock) + newSize);
+		if(block == NULL)
+			die("realloc");
+		if(block->prev)
+			block->prev->next = block;
+		else
+			arena->large = block;
+		if(block->next)
+			block->next->prev = block;
+		return block + 1;
+	}
+
+	void *new = arenaAlloc(newSize);
+	memcpy(new, p, size < newSize ? size : newSize);
+	arenaFree(p, size);
+	return new;
+}
+
+//Frees every row of the document in one go, the rows must not be used after it
+void arenaFreeAll()
+{
+	struct rowArena *arena = &Editor.arena;
+	while(arena->chunks)
+	{
+		char *chunk = arena->chunks;
+		arena->chunks = *(char **)chunk;
+		free(chunk);
+	}
+	while(arena->large)
+	{
+		struct arenaBlock *block = arena->large;
+		arena->large = block->next;
+		free(block);
+	}
+	memset(arena, 0, sizeof(struct rowArena));
+}
@@ -0,0 +1,1035 @@
+#include "editor.h"
+#include <malloc.h>
+#include <glob.h>
+
+//Headless benchmark, replays keystroke scripts against the editor core
+//The screen is a fixed BENCH_ROWS x BENCH_COLS and frames go to an in-memory sink
+//Usage: smk-bench [MB ...]
+
+#define BENCH_ROWS 24
+#define BENCH_COLS 80
+#define MAX_KEYS 65536
+#define SINK_SIZE (1 << 20)
+#define BENCH_EDITS 1000000
+
+struct benchOp
+{
+	const char *name;
+	double *samples;	//microseconds per key
+	int count;
+	int capacity;
+	long allocs;
+	long bytes;
+};
+
+long benchAllocs;		//counted by the --wrap'ed allocator below
+long benchBytes;		//written to the sink
+char benchSink[SINK_SIZE];
+
+int keys[MAX_KEYS];
+int keyHead;
+int keyTail;
+
+struct benchOp *currentOp;
+struct timespec sampleStart;
+long sampleAllocs;
+long sampleBytes;
+int sampling;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	benchAllocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	benchAllocs++;
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	benchAllocs++;
+	return __real_realloc(ptr, size);
+}
+
+double elapsedMicros(struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+void benchRecord(struct benchOp *op, double micros, long allocs, long bytes)
+{
+	if(op->count == op->capacity)
+	{
+		op->capacity = op->capacity ? op->capacity * 2 : 256;
+		op->samples = realloc(op->samples, sizeof(double) * op->capacity);
+	}
+	op->samples[op->count++] = micros;
+	op->allocs += allocs;
+	op->bytes += bytes;
+}
+
+//Closes the sample of the key returned last, it covers processing the key and the refresh after it
+void benchEndSample()
+{
+	if(!sampling)
+		return;
+	benchRecord(currentOp, elapsedMicros(&sampleStart), benchAllocs - sampleAllocs, benchBytes - sampleBytes);
+	sampling = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//* Platform  *///
+//*************///
+
+int editorReadKey()
+{
+	benchEndSample();
+	if(keyHead == keyTail)
+		die("script ran out of keys");
+
+	int c = keys[keyHead++];
+	sampling = 1;
+	sampleAllocs = benchAllocs;
+	sampleBytes = benchBytes;
+	clock_gettime(CLOCK_MONOTONIC, &sampleStart);
+	return c;
+}
+
+void editorWriteFrame(struct iovec *iov, int count)
+{
+	int j;
+	size_t at = 0;
+	for(j = 0; j < count; ++j)
+	{
+		size_t len = iov[j].iov_len;
+		if(at + len > SINK_SIZE)
+			len = SINK_SIZE - at;
+		memcpy(&benchSink[at], iov[j].iov_base, len);
+		at += len;
+		benchBytes += iov[j].iov_len;
+	}
+}
+
+void die(const char *s)
+{
+	perror(s);
+	exit(1);
+}
+
+void clearAndReposition()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//** Scripts  **///
+//*************///
+
+void pushKey(int c)
+{
+	if(keyTail == MAX_KEYS)
+		die("script too long");
+	keys[keyTail++] = c;
+}
+
+void pushString(const char *s)
+{
+	while(*s)
+		pushKey(*s++);
+}
+
+//Feeds the queued keys through the same refresh / key press loop as main()
+void runScript(struct benchOp *op)
+{
+	currentOp = op;
+	while(keyHead != keyTail)
+	{
+		editorRefreshScreen();
+		editorProcessKeyPress();
+	}
+	editorRefreshScreen();
+	benchEndSample();
+	keyHead = keyTail = 0;
+}
+
+//Writes about "mb" megabytes of C-like text with tabs and numbers
+void makeFile(const char *path, int mb)
+{
+	FILE *fp = fopen(path, "w");
+	if(!fp)
+		die(path);
+
+	long size = (long)mb << 20;
+	long written = 0;
+	int line = 0;
+	while(written < size)
+	{
+		int len;
+		switch(line % 4)
+		{
+			case 0:
+				len = fprintf(fp, "int value%d = %d;\t//line %d of the benchmark text\n", line, line * 7, line);
+				break;
+			case 1:
+				len = fprintf(fp, "\tif(value%d > %d)\n", line - 1, line);
+				break;
+			case 2:
+				len = fprintf(fp, "\t\treturn compute(value%d, \"some text here\");\n", line - 2);
+				break;
+			default:
+				len = fprintf(fp, "\n");
+				break;
+		}
+		written += len;
+		line++;
+	}
+	fclose(fp);
+}
+
+//Checks the tab index of the row against a plain walk over it, in both directions
+void checkColumns(erow *row)
+{
+	int rowX = 0;
+	int cursorX;
+	for(cursorX = 0; cursorX <= row->size; ++cursorX)
+	{
+		if(editorRowCursorXToRowX(row, cursorX) != rowX)
+		{
+			fprintf(stderr, "char %d is not at render column %d\n", cursorX, rowX);
+			exit(1);
+		}
+
+		int width = cursorX < row->size && row->chars[cursorX] == '\t' ? TAB_SIZE - rowX % TAB_SIZE : 1;
+		int x;
+		for(x = rowX; x < rowX + width; ++x)
+			if(editorRowRenderXToCursorX(row, x) != cursorX)
+			{
+				fprintf(stderr, "render column %d is not char %d\n", x, cursorX);
+				exit(1);
+			}
+		rowX += width;
+	}
+}
+
+//Checks the line counts of soft wrap against counting every row again
+void checkWrap()
+{
+	int line = 0;
+	int j;
+	for(j = 0; j < Editor.numRows; ++j)
+	{
+		int segment;
+		if(wrapLineOf(j) != line || wrapRowAt(line, &segment) != j || segment != 0)
+		{
+			fprintf(stderr, "row %d does not start on wrapped line %d\n", j, line);
+			exit(1);
+		}
+		line += wrapRowHeight(editorRowAt(j), wrapCurrent()->columns);
+	}
+	if(wrapLineOf(Editor.numRows) != line)
+	{
+		fprintf(stderr, "%d wrapped lines instead of %d\n", wrapLineOf(Editor.numRows), line);
+		exit(1);
+	}
+}
+
+//Checks the byte offsets of the rows against adding up the rows before them
+void checkOffsets()
+{
+	long long offset = 0;
+	int j;
+	for(j = 0; j < Editor.numRows; ++j)
+	{
+		erow *row = editorRowAt(j);
+		if(offsetOf(j) != offset || offsetRowAt(offset) != j || offsetRowAt(offset + row->size) != j)
+		{
+			fprintf(stderr, "row %d does not start at byte %lld\n", j, offset);
+			exit(1);
+		}
+		offset += row->size + 1;
+	}
+	if(offsetOf(Editor.numRows) != offset || offsetRowAt(offset) != Editor.numRows)
+	{
+		fprintf(stderr, "%lld bytes instead of %lld\n", offsetOf(Editor.numRows), offset);
+		exit(1);
+	}
+}
+
+//Heap in use and what the rows hold of it
+void reportMemory(char *report, size_t size)
+{
+	size_t rows = sizeof(erow) * (Editor.numRows + Editor.rowGapLen);
+	size_t text = 0, highLight = 0, tabs = 0;
+	int j;
+	for(j = 0; j < Editor.numRows; ++j)
+	{
+		erow *row = editorRowAt(j);
+		text += row->capacity;
+		highLight += row->hlSize;
+		tabs += sizeof(struct rowTab) * row->numTabs;
+	}
+
+	struct mallinfo2 info = mallinfo2();
+	snprintf(report, size, "memory: heap %.1f MB, rows %.1f MB, text %.1f MB, highlight %.1f MB, tabs %.1f MB, mapped %.1f MB\n",
+			(info.uordblks + info.hblkhd) / 1048576.0, rows / 1048576.0, text / 1048576.0, highLight / 1048576.0,
+			tabs / 1048576.0, Editor.mapSize / 1048576.0);
+}
+
+unsigned int documentHash()
+{
+	unsigned int hash = 2166136261u;
+	int j;
+	for(j = 0; j < Editor.numRows; ++j)
+	{
+		erow *row = editorRowAt(j);
+		hash = (hash ^ syntaxHash(row->chars, row->size)) * 16777619u;
+	}
+	return hash;
+}
+
+//Mostly typing runs, with deletes, new and joined rows and rows replaced, around a cursor that
+//wanders through the first rows of the file
+void editEverything(struct benchOp *op, int count)
+{
+	unsigned int seed = 1;
+	int row = 0, at = 0;
+	int j;
+	for(j = 0; j < count; ++j)
+	{
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		seed = seed * 1103515245 + 12345;
+		int what = (seed >> 16) % 100;
+
+		undoBegin();
+		if(what == 0 || row >= Editor.numRows)
+		{
+			row = (row + (seed >> 8) % 200) % (Editor.numRows < 2000 ? Editor.numRows : 2000);
+			at = 0;
+		}
+		erow *r = editorRowAt(row);
+		if(at > r->size)
+			at = r->size;
+		if(what < 80)
+			editorRowInsertChar(r, at++, "hello world "[j % 12]);
+		else if(what < 90 && at > 0)
+			editorRowDelChar(r, --at);
+		else if(what < 94)
+			editorInsertRow(row + 1, "inserted row", 12);
+		else if(what < 97 && Editor.numRows > 1)
+			editorDelRow(row);
+		else
+			editorRowSetString(r, "replaced row", 12);
+		if(op)
+			benchRecord(op, elapsedMicros(&start), 0, 0);
+	}
+}
+
+//Calls "step" until Editor.undo.numOps reaches "end"
+void timeUndo(struct benchOp *op, void (*step)(), int end)
+{
+	while(Editor.undo.numOps != end)
+	{
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		step();
+		benchRecord(op, elapsedMicros(&start), 0, 0);
+	}
+}
+
+//Bytes the rows take in a file
+off_t savedSize()
+{
+	off_t size = 0;
+	int j;
+	for(j = 0; j < Editor.numRows; ++j)
+		size += editorRowAt(j)->size + 1;
+	return size;
+}
+
+//The saved file has "size" bytes, and no temporary file is left next to it
+void checkSaved(const char *path, off_t size)
+{
+	struct stat st;
+	if(stat(path, &st) == -1 || st.st_size != size)
+	{
+		fprintf(stderr, "saved %lld bytes instead of %lld\n", (long long)st.st_size, (long long)size);
+		exit(1);
+	}
+	glob_t left;
+	if(glob("/tmp/.smk-bench-*.out.??????", 0, NULL, &left) == 0)
+	{
+		fprintf(stderr, "%s left after saving\n", left.gl_pathv[0]);
+		exit(1);
+	}
+	globfree(&left);
+}
+
+int openFile(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+		die("open");
+	return fd;
+}
+
+int compareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+double percentile(struct benchOp *op, double p)
+{
+	int at = (int)(p * (op->count - 1) + 0.5);
+	return op->samples[at];
+}
+
+void report(struct benchOp *op)
+{
+	if(op->count == 0)
+		return;
+	qsort(op->samples, op->count, sizeof(double), compareDouble);
+	printf("%-9s %6d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", op->name, op->count,
+			percentile(op, 0.5), percentile(op, 0.9), percentile(op, 0.99), op->samples[op->count - 1],
+			(double)op->allocs / op->count, (double)op->bytes / op->count);
+	free(op->samples);
+}
+
+//What the scenarios of one file share; they run in order, each on the document the one before left
+struct benchRun
+{
+	int mb;
+	char path[64];
+	char savePath[64];
+	int rows;			//of the file as loaded
+	unsigned int loaded;	//documentHash() of the file as loaded
+	char memory[256];
+	size_t journalSize;
+	size_t viewerHeap;
+	struct benchOp open, reopen, stream, switchBuffer, highlight, type, split, paste, page, jump, longLine,
+			wrap, find, replace, save, journal, undo, redo, viewerOpen, viewerIndex, viewerKeys, viewerFind;
+} run;
+
+//Typing in the middle of the file with new lines and backspaces, for "count" keys
+void pushTyping(int count)
+{
+	int j;
+	for(j = 0; j < count; ++j)
+	{
+		if(j % 40 == 39)
+			pushKey('\r');
+		else if(j % 10 == 9)
+			pushKey(BACKSPACE);
+		else
+			pushKey("hello world "[j % 12]);
+	}
+}
+
+//stream: the file read like a pipe, every row copied
+void benchStream()
+{
+	int j;
+	for(j = 0; j < 3; ++j)
+	{
+		struct timespec start;
+		long allocs = benchAllocs;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		initEditor();
+		editorOpenStream(openFile(run.path));
+		while(Editor.loading)
+			editorLoadStep();
+		benchRecord(&run.stream, elapsedMicros(&start), benchAllocs - allocs, 0);
+	}
+}
+
+//open: until the whole file is loaded and the first screen is drawn
+void benchOpen()
+{
+	int j;
+	for(j = 0; j < 3; ++j)
+	{
+		struct timespec start;
+		long allocs = benchAllocs;
+		long bytes = benchBytes;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		initEditor();
+		fileTrim(0);	//not from the file cache
+		editorOpen(run.path);
+		while(Editor.loading)
+			editorLoadStep();
+		editorRefreshScreen();
+		benchRecord(&run.open, elapsedMicros(&start), benchAllocs - allocs, benchBytes - bytes);
+	}
+	run.rows = Editor.numRows;
+	run.loaded = documentHash();
+}
+
+//reopen: the same version of the file again, its rows come from the file cache
+void benchReopen()
+{
+	int j;
+	for(j = 0; j < 3; ++j)
+	{
+		struct timespec start;
+		long allocs = benchAllocs;
+		long bytes = benchBytes;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		initEditor();
+		editorOpen(run.path);
+		editorRefreshScreen();
+		benchRecord(&run.reopen, elapsedMicros(&start), benchAllocs - allocs, benchBytes - bytes);
+	}
+	if(Editor.loading || documentHash() != run.loaded)
+	{
+		fprintf(stderr, "reopen: the cached file gave other rows than loading it\n");
+		exit(1);
+	}
+}
+
+//switch: back and forth between the file and a second buffer
+void benchSwitch()
+{
+	int j;
+	bufferNew();
+	editorInsertRow(0, "second buffer", 13);
+	for(j = 0; j < 1000; ++j)
+		pushKey(CTRL_KEY('n'));
+	runScript(&run.switchBuffer);
+	editorCloseBuffer();
+	if(Editor.numRows != run.rows || documentHash() != run.loaded)
+	{
+		fprintf(stderr, "switch: switching buffers changed the file\n");
+		exit(1);
+	}
+
+	//the file again while it loads: going to another buffer pauses the load instead of finishing
+	//it, back on the file it goes on from where it stopped
+	initEditor();
+	fileTrim(0);
+	editorOpen(run.path);
+	bufferNew();
+	editorInsertRow(0, "second buffer", 13);
+	pushKey(CTRL_KEY('n'));
+	runScript(&run.switchBuffer);
+	if(!Editor.loading || Editor.numRows >= run.rows)
+	{
+		fprintf(stderr, "switch: leaving the file loaded all of it\n");
+		exit(1);
+	}
+	while(Editor.loading)
+		editorLoadStep();
+	pushKey(CTRL_KEY('n'));
+	runScript(&run.switchBuffer);
+	editorCloseBuffer();
+	if(Editor.numRows != run.rows || documentHash() != run.loaded)
+	{
+		fprintf(stderr, "switch: the load that was paused gave other rows\n");
+		exit(1);
+	}
+}
+
+//highlight: the whole file at once, as if all of it was on screen
+void benchHighlight()
+{
+	struct timespec start;
+	long allocs = benchAllocs;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	editorHighlightRows(0, Editor.numRows - 1);
+	benchRecord(&run.highlight, elapsedMicros(&start), benchAllocs - allocs, 0);
+	reportMemory(run.memory, sizeof(run.memory));	//with every row highlighted
+}
+
+//type: in the middle of the file, with new lines and backspaces
+void benchType()
+{
+	Editor.cursorY = Editor.numRows / 2;
+	pushTyping(2000);
+	runScript(&run.type);
+}
+
+//split: the same typing with the file in two views side by side and another document below
+//the second; only the views of the file are drawn again
+void benchSplit()
+{
+	editorSplitView(1);
+	editorSplitView(0);
+	bufferNew();
+	editorInsertRow(0, "second buffer", 13);
+	viewFocus(0);
+	pushTyping(2000);
+	runScript(&run.split);
+	viewFocus(2);
+	editorCloseBuffer();
+	editorCloseView();
+	editorCloseView();
+}
+
+//paste: 100 KB of lines as one bracketed paste
+void benchPaste()
+{
+	int j;
+	appendBufferReset(&Editor.paste);
+	while(Editor.paste.len < 100 * 1024)
+		appendBufferAppend(&Editor.paste, "pasted text, pasted text\r", 25);
+	for(j = 0; j < 10; ++j)
+		pushKey(PASTE);
+	runScript(&run.paste);
+}
+
+//page: down and back up from the top
+void benchPage()
+{
+	int j;
+	Editor.cursorY = Editor.cursorX = 0;
+	for(j = 0; j < 500; ++j)
+		pushKey(PAGE_DOWN);
+	for(j = 0; j < 500; ++j)
+		pushKey(PAGE_UP);
+	runScript(&run.page);
+}
+
+//goto: lines, byte offsets and percentages typed into the CTRL G prompt, the keys of the
+//prompt are part of the samples
+void benchGoTo()
+{
+	long long size = offsetOf(Editor.numRows);
+	int j;
+	for(j = 0; j < 300; ++j)
+	{
+		char target[32];
+		if(j % 3 == 0)
+			snprintf(target, sizeof(target), "%d", (int)((long long)run.rows * (j * 7 % 100) / 100) + 1);
+		else if(j % 3 == 1)
+			snprintf(target, sizeof(target), "@%lld", size * (j * 7 % 100) / 100);
+		else
+			snprintf(target, sizeof(target), "%d%%", j * 7 % 100);
+		pushKey(CTRL_KEY('g'));
+		pushString(target);
+		pushKey('\r');
+	}
+	runScript(&run.jump);
+	if(offsetOf(Editor.cursorY) + Editor.cursorX != size * (299 * 7 % 100) / 100)
+	{
+		fprintf(stderr, "goto: the cursor is not at the byte it went to\n");
+		exit(1);
+	}
+	pushKey(CTRL_KEY('g'));
+	pushString("010");
+	pushKey('\r');
+	runScript(&run.jump);
+	if(Editor.cursorY != 9)
+	{
+		fprintf(stderr, "goto: \"010\" went to line %d, not 10\n", Editor.cursorY + 1);
+		exit(1);
+	}
+	checkOffsets();
+}
+
+//longline: moving along a 64 KB line with tabs, then the column mapping is checked; the line
+//stays for the wrap scenario
+void benchLongLine()
+{
+	char line[65536];
+	int j;
+	for(j = 0; j < (int)sizeof(line); ++j)
+		line[j] = j % 11 == 0 ? '\t' : "{\"key\":[1,2]}"[j % 13];
+	editorInsertRow(Editor.numRows, line, sizeof(line));
+
+	Editor.cursorY = Editor.numRows - 1;
+	Editor.cursorX = 0;
+	pushKey(END_KEY);
+	for(j = 0; j < 500; ++j)
+		pushKey(ARROW_LEFT);
+	pushKey(HOME_KEY);
+	for(j = 0; j < 500; ++j)
+		pushKey(ARROW_RIGHT);
+	runScript(&run.longLine);
+	checkColumns(editorRowAt(Editor.numRows - 1));
+	for(j = 0; j < Editor.numRows && j < 10000; ++j)
+		checkColumns(editorRowAt(j));
+}
+
+//wrap: soft wrap on, typing in the middle of the file and paging down from there, then paging
+//over the 64 KB line, which takes over a thousand lines; then the line counts are checked
+void benchWrap()
+{
+	int j;
+	editorToggleWrap();
+	Editor.cursorY = Editor.numRows / 3;
+	pushTyping(1000);
+	for(j = 0; j < 200; ++j)
+		pushKey(PAGE_DOWN);
+	runScript(&run.wrap);
+	Editor.cursorY = Editor.numRows - 2;
+	for(j = 0; j < 60; ++j)
+		pushKey(PAGE_DOWN);
+	runScript(&run.wrap);
+	checkWrap();
+	if(Editor.cursorY != Editor.numRows)
+	{
+		fprintf(stderr, "wrap: paging down by wrapped lines stopped at row %d\n", Editor.cursorY);
+		exit(1);
+	}
+	for(j = 0; j < 100; ++j)
+		pushKey(ARROW_UP);
+	runScript(&run.wrap);
+	editorToggleWrap();
+	editorDelRow(Editor.numRows - 1);
+}
+
+//find: every key typed in the prompt searches again
+void benchFind()
+{
+	int j;
+	for(j = 0; j < 5; ++j)
+	{
+		char query[32];
+		snprintf(query, sizeof(query), "value%d ", (run.rows / 5) * j + 1);
+		pushKey(CTRL_KEY('f'));
+		pushString(query);
+		pushKey(ARROW_DOWN);
+		pushKey('\r');
+	}
+	runScript(&run.find);
+}
+
+//replace: regex over the whole file, the two prompts are part of the samples; then it is undone
+//and done again, the journal only holds the spans that changed
+void benchReplace()
+{
+	unsigned int before = documentHash();
+	size_t journal = undoSize();
+	int from = Editor.undo.totalOps;
+	pushKey(CTRL_KEY('r'));
+	pushString("value([0-9]+) >");
+	pushKey('\r');
+	pushString("\\1 <");
+	pushKey('\r');
+	runScript(&run.replace);
+	unsigned int after = documentHash();
+	int ops = Editor.undo.totalOps - from;
+	size_t text = undoSize() - journal - sizeof(struct undoOp) * ops;
+	if(text > 32 * (size_t)ops)		//"value12345 >" and "12345 <", not the whole rows
+	{
+		fprintf(stderr, "replace: %zu bytes of text journaled for %d rows\n", text, ops);
+		exit(1);
+	}
+	Editor.dirty = 0;		//as after a save
+	editorUndo();
+	if(documentHash() != before || Editor.dirty == 0)
+	{
+		fprintf(stderr, "replace: undoing it did not give the file back as a change\n");
+		exit(1);
+	}
+	Editor.dirty = 0;
+	editorRedo();
+	if(documentHash() != after || Editor.dirty == 0)
+	{
+		fprintf(stderr, "replace: redoing it did not give the replaced file as a change\n");
+		exit(1);
+	}
+}
+
+//save: into a separate file so the source can be reused, the samples are how long the UI is
+//held up while the save thread writes; keys typed meanwhile stay unsaved
+void benchSave()
+{
+	int j;
+	free(Editor.filename);
+	Editor.filename = strdup(run.savePath);
+	for(j = 0; j < 3; ++j)
+	{
+		pushKey(CTRL_KEY('s'));
+		runScript(&run.save);
+		off_t size = savedSize();
+		Editor.cursorY = 0;
+		pushString("typed while saving");
+		runScript(&run.save);
+		editorFinishSave();
+		checkSaved(run.savePath, size);
+		struct stat st;
+		mode_t mask = umask(0);
+		umask(mask);
+		if(stat(run.savePath, &st) == 0 && (st.st_mode & 07777) != (0666 & ~mask))
+		{
+			fprintf(stderr, "save: a new file got mode %o, not %o\n", st.st_mode & 07777, 0666 & ~mask);
+			exit(1);
+		}
+		if(Editor.dirty != 18)
+		{
+			fprintf(stderr, "save: %d edits unsaved instead of 18\n", Editor.dirty);
+			exit(1);
+		}
+	}
+}
+
+//journal, undo, redo: a million edits, undone back to the file and done again
+void benchJournal()
+{
+	Editor.undo.limit = (size_t)1 << 30;
+	unsigned int before = documentHash();
+	int from = Editor.undo.numOps;
+	run.journalSize = undoSize();
+	editEverything(&run.journal, BENCH_EDITS);
+	unsigned int after = documentHash();
+	run.journalSize = undoSize() - run.journalSize;
+	timeUndo(&run.undo, editorUndo, from);
+	if(documentHash() != before)
+	{
+		fprintf(stderr, "undo: undoing every edit did not give the file back\n");
+		exit(1);
+	}
+	timeUndo(&run.redo, editorRedo, Editor.undo.totalOps);
+	if(documentHash() != after)
+	{
+		fprintf(stderr, "redo: redoing every edit did not give the edited file\n");
+		exit(1);
+	}
+	Editor.undo.limit = 1 << 20;
+	editEverything(NULL, BENCH_EDITS / 10);
+	if(undoSize() > Editor.undo.limit)
+	{
+		fprintf(stderr, "journal: %zu bytes over its limit\n", undoSize());
+		exit(1);
+	}
+	Editor.undo.limit = UNDO_LIMIT;
+	checkOffsets();
+}
+
+//viewer: the file in viewer mode, until the first screen is drawn and until its rows are
+//counted; then paging, jumps and searches streaming through the mapping, and every row read
+//through the chunks is checked against the loaded file
+void benchViewer()
+{
+	size_t threshold = viewerThreshold;
+	viewerThreshold = 0;
+	initEditor();
+	struct mallinfo2 info = mallinfo2();
+	size_t heap = info.uordblks + info.hblkhd;
+	int j;
+	for(j = 0; j < 3; ++j)
+	{
+		struct timespec start;
+		long allocs = benchAllocs;
+		long bytes = benchBytes;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		initEditor();
+		editorOpen(run.path);
+		editorRefreshScreen();
+		benchRecord(&run.viewerOpen, elapsedMicros(&start), benchAllocs - allocs, benchBytes - bytes);
+	}
+	{
+		struct timespec start;
+		long allocs = benchAllocs;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		while(viewerIndexStep())
+			;
+		benchRecord(&run.viewerIndex, elapsedMicros(&start), benchAllocs - allocs, 0);
+	}
+	for(j = 0; j < 500; ++j)
+		pushKey(PAGE_DOWN);
+	for(j = 0; j < 100; ++j)
+	{
+		char target[32];
+		snprintf(target, sizeof(target), "%d%%", j * 37 % 100);
+		pushKey(CTRL_KEY('g'));
+		pushString(target);
+		pushKey('\r');
+	}
+	runScript(&run.viewerKeys);
+	char query[32];
+	for(j = 0; j < 5; ++j)
+	{
+		snprintf(query, sizeof(query), "value%d ", (run.rows / 5) * j / 4 * 4);	//on a row of its own
+		pushKey(CTRL_KEY('f'));
+		pushString(query);
+		pushKey(ARROW_DOWN);
+		pushKey(ARROW_UP);
+		pushKey('\r');
+	}
+	runScript(&run.viewerFind);
+	erow *found = editorRowAt(Editor.cursorY);
+	if(Editor.numRows != run.rows || Editor.cursorX + strlen(query) > (size_t)found->size
+		|| memcmp(&found->chars[Editor.cursorX], query, strlen(query)) != 0)
+	{
+		fprintf(stderr, "vfind: viewer search stopped at %d,%d, not on \"%s\"\n", Editor.cursorY, Editor.cursorX, query);
+		exit(1);
+	}
+	if(documentHash() != run.loaded)
+	{
+		fprintf(stderr, "viewer: the viewer gave other rows than loading the file\n");
+		exit(1);
+	}
+	checkOffsets();
+	info = mallinfo2();
+	run.viewerHeap = info.uordblks + info.hblkhd - heap;
+	if(run.viewerHeap > (8 << 20))
+	{
+		fprintf(stderr, "viewer: the viewer took %.1f MB of heap\n", run.viewerHeap / 1048576.0);
+		exit(1);
+	}
+	initEditor();
+	viewerThreshold = threshold;
+}
+
+//Rows of C with the length of each a little different, and different for each file name, added
+//after the syntax is picked as when they are loaded or typed
+void fillWorkerRows(const char *filename)
+{
+	char text[] = "int value = 42; /* comment */ if(x) return \"some text\" + compute(y, 'c');";
+	free(Editor.filename);
+	Editor.filename = strdup(filename);
+	editorSelectSyntax();
+	int j;
+	for(j = 0; j < BENCH_ROWS * 2; ++j)
+		editorInsertRow(j, text, (j * 7 + (int)strlen(filename)) % (int)strlen(text));
+}
+
+//Waits for the worker's results and applies them until the rows on screen are highlighted,
+//each of them has to have the colors of its own text
+void checkWorkerRows(const char *what)
+{
+	struct pollfd wait = {highlightPipe[0], POLLIN, 0};
+	int rounds;
+	int j;
+	for(rounds = 0; rounds < 1000; ++rounds)
+	{
+		poll(&wait, 1, 10);
+		highlightReadable(highlightPipe[0]);
+		for(j = 0; j < Editor.screenRows && j < Editor.numRows; ++j)
+		{
+			erow *row = editorRowAt(j);
+			if(row->hlSize > row->size)
+			{
+				fprintf(stderr, "worker: %s gave row %d of %d chars %d colors\n", what, j, row->size, row->hlSize);
+				exit(1);
+			}
+			if(!row->highlighted)
+				break;
+		}
+		if(j == Editor.screenRows || j == Editor.numRows)
+			break;
+		editorRefreshScreen();		//rows whose results were dropped are queued again
+	}
+	for(j = 0; j < Editor.screenRows && j < Editor.numRows; ++j)
+	{
+		erow *row = editorRowAt(j);
+		unsigned char expected[128];
+		memset(expected, HL_NORMAL, row->size);
+		editorSyntaxLine(Editor.syntax, row->chars, row->size, expected, row->hlStateIn);
+		if(!row->highlighted || (row->size && memcmp(row->highLight, expected, row->size) != 0))
+		{
+			fprintf(stderr, "worker: %s left row %d with the colors of another row\n", what, j);
+			exit(1);
+		}
+	}
+}
+
+//The highlight worker with its jobs in flight while a row is added above the rows on screen, and
+//while another document is shown; results may only go to the row they were made for
+//The worker keeps running from here on, so this comes after the files
+void checkHighlighter()
+{
+	editorStartHighlighter();
+
+	initEditor();
+	fillWorkerRows("worker.c");
+	editorRefreshScreen();		//queues the rows on screen
+	editorInsertRow(0, "", 0);
+	checkWorkerRows("adding a row");
+
+	initEditor();
+	fillWorkerRows("worker.c");
+	editorRefreshScreen();
+	bufferNew();
+	fillWorkerRows("other.c");
+	checkWorkerRows("another document");
+	editorCloseBuffer();
+	initEditor();
+}
+
+void benchFile(int mb)
+{
+	memset(&run, 0, sizeof(run));
+	run.mb = mb;
+	snprintf(run.path, sizeof(run.path), "/tmp/smk-bench-%d.c", (int)getpid());
+	snprintf(run.savePath, sizeof(run.savePath), "/tmp/smk-bench-%d.out", (int)getpid());
+	makeFile(run.path, mb);
+
+	struct benchOp *ops[] = {&run.open, &run.reopen, &run.stream, &run.switchBuffer, &run.highlight,
+			&run.type, &run.split, &run.paste, &run.page, &run.jump, &run.longLine, &run.wrap, &run.find,
+			&run.replace, &run.save, &run.journal, &run.undo, &run.redo, &run.viewerOpen, &run.viewerIndex,
+			&run.viewerKeys, &run.viewerFind};
+	const char *names[] = {"open", "reopen", "stream", "switch", "highlight", "type", "split", "paste",
+			"page", "goto", "longline", "wrap", "find", "replace", "save", "journal", "undo", "redo", "vopen",
+			"vindex", "viewer", "vfind"};
+	int count = sizeof(ops) / sizeof(ops[0]);
+	int j;
+	for(j = 0; j < count; ++j)
+		ops[j]->name = names[j];
+
+	benchStream();
+	benchOpen();
+	benchReopen();
+	benchSwitch();
+	benchHighlight();
+	benchType();
+	benchSplit();
+	benchPaste();
+	benchPage();
+	benchGoTo();
+	benchLongLine();
+	benchWrap();
+	benchFind();
+	benchReplace();
+	benchSave();
+	benchJournal();
+	benchViewer();
+
+	printf("\n%d MB, %d lines\n%sviewer: heap %.1f MB after reading every row\njournal: %.1f MB for %d edits\n\n",
+			mb, run.rows, run.memory, run.viewerHeap / 1048576.0, run.journalSize / 1048576.0, BENCH_EDITS);
+	printf("%-9s %6s %10s %10s %10s %10s %10s %10s\n", "op", "keys", "p50(us)", "p90(us)", "p99(us)",
+			"max(us)", "allocs/key", "bytes/key");
+	for(j = 0; j < count; ++j)
+		report(ops[j]);
+
+	swapStop();
+	unlink(run.path);
+	unlink(run.savePath);
+}
+
+int main(int argc, char **argv)
+{
+	initEditor();
+	editorResize(BENCH_ROWS, BENCH_COLS);
+
+	if(argc < 2)
+	{
+		benchFile(1);
+		benchFile(16);
+		checkHighlighter();
+		return 0;
+	}
+
+	int j;
+	for(j = 1; j < argc; ++j)
+		benchFile(atoi(argv[j]));
+	checkHighlighter();
+	return 0;
+}
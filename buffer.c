@@ -0,0 +1,332 @@
+#include "editor.h"
+
+#define FILE_CACHE_IDLE 4		//mapped files no document uses that are kept
+
+//Open documents, Editor is the current one and the others wait in "buffers"
+//A document is everything in Editor but the screen, so switching is a copy of the struct in each
+//direction; its rows, highlight and undo journal stay as they are and nothing is loaded again
+//Files are mapped through a cache keyed by path, inode and mtime, with the line index the first
+//load of a version built, so opening that version again does not read the file
+
+struct editorConf *buffers;		//buffers[currentBuffer] is out of date while Editor holds it
+int numBuffers = 1;
+int buffersCapacity;
+int currentBuffer;
+struct fileCache *files;	//most recently opened first
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//** Buffers ***///
+//*************///
+
+//Makes "document" the current one, the screen and the counters shared by every document stay
+void bufferShow(struct editorConf *document)
+{
+	struct editorConf screen = Editor;
+	Editor = *document;
+
+	Editor.terminalRows = screen.terminalRows;
+	Editor.terminalColumns = screen.terminalColumns;
+	Editor.screenTop = screen.screenTop;
+	Editor.screenLeft = screen.screenLeft;
+	Editor.screenRows = screen.screenRows;
+	Editor.screenColumns = screen.screenColumns;
+	memcpy(Editor.statusmsg, screen.statusmsg, sizeof(Editor.statusmsg));
+	Editor.statusmsg_time = screen.statusmsg_time;
+	Editor.shadow = screen.shadow;
+	Editor.shadowLines = screen.shadowLines;
+	Editor.shadowValid = screen.shadowValid;
+	Editor.shadowOffset = Editor.rowOffset;		//not a scroll, the lines are compared one by one
+	Editor.frame = screen.frame;
+	Editor.frameLine = screen.frameLine;
+	Editor.frameRefs = screen.frameRefs;
+	Editor.frameBytes = screen.frameBytes;
+	Editor.frameAllocs = screen.frameAllocs;
+	Editor.showFrameStats = screen.showFrameStats;
+	Editor.softWrap = screen.viewer ? screen.viewer->softWrap : screen.softWrap;
+	if(Editor.viewer)
+	{
+		Editor.viewer->softWrap = Editor.softWrap;		//for the documents after it
+		Editor.softWrap = 0;
+	}
+	Editor.paste = screen.paste;
+	Editor.search = screen.search;
+	Editor.highLightGeneration = screen.highLightGeneration;	//results for another document never match
+	Editor.highLightJobs = screen.highLightJobs;
+	Editor.highLightDropped = screen.highLightDropped;
+	Editor.highLightNow = screen.highLightNow;
+	Editor.orig_termios = screen.orig_termios;
+}
+
+void bufferSwitch(int at)
+{
+	if(at == currentBuffer)
+		return;
+	buffers[currentBuffer] = Editor;
+	currentBuffer = at;
+	bufferShow(&buffers[at]);
+}
+
+//Gets the current document ready to wait in the background, its load stops where it is and
+//its save thread goes on but is only finished once the document is current again
+//The event loop only ever works on the current document, see bufferResume()
+void bufferLeave()
+{
+	if(Editor.loading && Editor.loadFd != -1)
+		editorUnwatchFd(Editor.loadFd);
+	else if(Editor.loading)
+		editorRemoveTask(editorLoadStep);
+	saveWatch(0);
+	editorRemoveTask(viewerIndexStep);
+}
+
+//Picks up the load, save and row count of the document that is current again where
+//bufferLeave() left them
+void bufferResume()
+{
+	if(Editor.loading && Editor.loadFd != -1)
+	{
+		editorUnwatchFd(Editor.loadFd);
+		editorWatchFd(Editor.loadFd, editorLoadReadable);
+	}
+	else if(Editor.loading)
+		editorAddTask(editorLoadStep);
+	saveWatch(1);
+	if(Editor.viewer && Editor.viewer->indexing)
+		editorAddTask(viewerIndexStep);
+}
+
+//Opens an empty document at the end of the list and makes it current
+void bufferNew()
+{
+	if(numBuffers + 1 > buffersCapacity)
+	{
+		buffersCapacity = buffersCapacity ? buffersCapacity * 2 : 8;
+		buffers = realloc(buffers, sizeof(struct editorConf) * buffersCapacity);
+		if(buffers == NULL)
+			die("realloc");
+	}
+	bufferLeave();
+	buffers[currentBuffer] = Editor;
+	currentBuffer = numBuffers++;
+
+	struct editorConf empty;
+	memset(&empty, 0, sizeof(empty));
+	bufferShow(&empty);
+	initEditor();
+}
+
+//Index of the document "filename" is open in, -1 when there is none
+int bufferFind(const char *filename)
+{
+	char *path = realpath(filename, NULL);
+	int found = -1;
+	int j;
+	for(j = 0; path && j < numBuffers && found == -1; ++j)
+	{
+		char *name = j == currentBuffer ? Editor.filename : buffers[j].filename;
+		char *other = name ? realpath(name, NULL) : NULL;
+		if(other && strcmp(path, other) == 0)
+			found = j;
+		free(other);
+	}
+	free(path);
+	return found;
+}
+
+//Index of the current document in the list
+int bufferIndex()
+{
+	return currentBuffer;
+}
+
+void bufferStatus()
+{
+	editorSetStatusMessage("Buffer %d/%d: %s", currentBuffer + 1, numBuffers,
+			Editor.filename ? Editor.filename : "[No Name]");
+}
+
+//Opens "filename" in a document of its own, or goes to the one that has it open already
+//An empty document that was never changed is replaced instead
+void bufferOpen(char *filename)
+{
+	int fd = open(filename, O_RDONLY);
+	if(fd == -1)
+	{
+		editorSetStatusMessage("Can't open %s: %s", filename, strerror(errno));
+		return;
+	}
+	close(fd);
+	bufferLeave();
+
+	int at = bufferFind(filename);
+	if(at != -1)
+	{
+		bufferSwitch(at);
+		bufferResume();
+		bufferStatus();
+		return;
+	}
+	if(Editor.filename || Editor.numRows || Editor.dirty)
+		bufferNew();
+	else
+		initEditor();
+	Editor.filename = strdup(filename);
+	bufferStatus();		//unless editorOpen() has more to say
+	editorOpen(filename);
+}
+
+//Goes "delta" documents forward in the list, wrapping around
+void editorSwitchBuffer(int delta)
+{
+	if(numBuffers == 1)
+	{
+		editorSetStatusMessage("No other buffer, CTRL O opens a file in a new one");
+		return;
+	}
+	bufferLeave();
+	bufferSwitch((currentBuffer + delta % numBuffers + numBuffers) % numBuffers);
+	bufferResume();
+	bufferStatus();
+}
+
+//Closes the current document and shows the one before it, in every view that had it
+//Returns 0 when it is the last one, which is left open
+int editorCloseBuffer()
+{
+	if(numBuffers == 1)
+		return 0;
+
+	int closed = currentBuffer;
+	initEditor();
+	memmove(&buffers[currentBuffer], &buffers[currentBuffer + 1],
+			sizeof(struct editorConf) * (numBuffers - currentBuffer - 1));
+	numBuffers--;
+	if(currentBuffer > 0)
+		currentBuffer--;
+	bufferShow(&buffers[currentBuffer]);
+	bufferResume();
+	viewBufferClosed(closed);
+	bufferStatus();
+	return 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//* File cache *///
+//*************///
+
+//Maps the regular file open on "fd", or returns the mapping of the same version when it is cached
+//Returns NULL when it can't be mapped
+struct fileCache *fileOpen(const char *filename, int fd, struct stat *st)
+{
+	char *path = realpath(filename, NULL);
+	if(path == NULL)
+		path = strdup(filename);
+	if(path == NULL)
+		die("malloc");
+
+	struct fileCache **link;
+	struct fileCache *file;
+	for(link = &files; (file = *link) != NULL; link = &file->next)
+	{
+		if(file->inode == st->st_ino && file->device == st->st_dev && file->size == (size_t)st->st_size
+			&& file->mtime.tv_sec == st->st_mtim.tv_sec && file->mtime.tv_nsec == st->st_mtim.tv_nsec
+			&& strcmp(file->path, path) == 0)
+		{
+			*link = file->next;
+			file->next = files;
+			files = file;
+			file->refs++;
+			free(path);
+			return file;
+		}
+	}
+
+	char *map = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(map == MAP_FAILED)
+	{
+		free(path);
+		return NULL;
+	}
+	file = calloc(1, sizeof(struct fileCache));
+	if(file == NULL)
+		die("calloc");
+	file->path = path;
+	file->device = st->st_dev;
+	file->inode = st->st_ino;
+	file->mtime = st->st_mtim;
+	file->map = map;
+	file->size = st->st_size;
+	file->refs = 1;
+	file->next = files;
+	files = file;
+	fileTrim(FILE_CACHE_IDLE);
+	return file;
+}
+
+//A document stopped using the mapping
+void fileRelease(struct fileCache *file)
+{
+	if(file == NULL)
+		return;
+	file->refs--;
+	fileTrim(FILE_CACHE_IDLE);
+}
+
+//Unmaps the files no document uses, but for the "keep" opened last
+void fileTrim(int keep)
+{
+	struct fileCache **link = &files;
+	struct fileCache *file;
+	while((file = *link) != NULL)
+	{
+		if(file->refs == 0 && keep-- <= 0)
+		{
+			*link = file->next;
+			munmap(file->map, file->size);
+			free(file->lines);
+			free(file->path);
+			free(file);
+		}
+		else
+			link = &file->next;
+	}
+}
+
+//Adds the row just loaded from the mapping to the line index, its line ends before "end"
+void fileIndexRow(struct fileCache *file, erow *row, size_t end)
+{
+	if(file->numLines == file->linesCapacity)
+	{
+		file->linesCapacity = file->linesCapacity ? file->linesCapacity * 2 : 1024;
+		file->lines = realloc(file->lines, sizeof(struct iovec) * file->linesCapacity);
+		if(file->lines == NULL)
+			die("realloc");
+	}
+	file->lines[file->numLines++] = (struct iovec) {row->chars, row->size};
+	file->indexed = end;
+}
+
+//Rows of a file that was loaded before, straight from its line index
+//They are added at the end in one go, a row editorNewRow() opens is all zeros but for its text
+//and its highlight generation
+void fileLoadRows(struct fileCache *file)
+{
+	editorMoveGap(Editor.numRows);
+	wrapReset();		//the slots move
+	offsetReset();
+	erow *rows = realloc(Editor.row, sizeof(erow) * (Editor.numRows + Editor.rowGapLen + file->numLines));
+	if(rows == NULL)
+		die("realloc");
+	Editor.row = rows;
+
+	erow *row = &Editor.row[Editor.numRows];
+	int j;
+	for(j = 0; j < file->numLines; ++j)
+		row[j] = (erow) {.chars = file->lines[j].iov_base, .size = file->lines[j].iov_len,
+				.hlGeneration = ++Editor.highLightGeneration};
+	editorHighlightChanged(Editor.numRows);
+	Editor.numRows += file->numLines;
+	Editor.rowGap = Editor.numRows;
+}
@@ -0,0 +1,1482 @@
+#include "editor.h"
+
+#define ABUF_INIT {NULL, 0, 0}
+#define QUIT_TIMES 3
+#define VERSION "0.0.5"
+#define ABSOLUTE 1
+#define RELATIVE 0
+#define OFF -1
+#define SIZE(x) sizeof(x) / sizeof(x[0])
+#define LOAD_CHUNK (1 << 20)		//bytes indexed between two checks of the time budget
+#define LOAD_BUDGET_MS 30		//time spent loading before the screen is refreshed
+#define STATUS_TIMEOUT 5		//seconds a status message stays up
+
+struct editorConf Editor;
+int appendBufferAllocs;		//reallocs done by appendBufferAppend, for the frame stats
+
+//Appends text to the appendBuffer, doubling its capacity when it is full
+void appendBufferAppend(struct appendBuffer *ab, const char *s, int len) 
+{
+	if(ab->len + len > ab->capacity)
+	{
+		int capacity = ab->capacity ? ab->capacity : 64;
+		while(capacity < ab->len + len)
+			capacity *= 2;
+
+		char *new = realloc(ab->buffer, capacity);
+		if (new == NULL) 
+			return;
+		ab->buffer = new;
+		ab->capacity = capacity;
+		appendBufferAllocs++;
+	}
+
+	memcpy(&ab->buffer[ab->len], s, len);
+	ab->len += len;
+}
+
+//Empties the buffer but keeps its memory for the next use
+void appendBufferReset(struct appendBuffer *ab)
+{
+	ab->len = 0;
+}
+
+//Frees the allocated buffer
+void appendBufferFree(struct appendBuffer *ab) 
+{
+	free(ab->buffer);
+	ab->buffer = NULL;
+	ab->len = 0;
+	ab->capacity = 0;
+}
+
+//Writes every buffer in "iov", resuming after partial writes and interrupted calls
+int writeAll(int fd, struct iovec *iov, int count)
+{
+	while(count > 0)
+	{
+		ssize_t written = writev(fd, iov, count > IOV_MAX ? IOV_MAX : count);
+		if(written == -1)
+		{
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN)
+			{
+				struct pollfd pfd = {fd, POLLOUT, 0};
+				poll(&pfd, 1, -1);
+				continue;
+			}
+			return -1;
+		}
+
+		while(count > 0 && (size_t)written >= iov->iov_len)
+		{
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if(count > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//***FILE IO **///
+//*************///
+
+//Opens a file with name from command line
+//Regular files are mapped through the file cache, anything else (pipes, devices) is streamed
+//Either way the rows are loaded in the background by editorLoadStep(), but for files of
+//viewerThreshold bytes or more, which are shown read only through the viewer, see viewer.c
+//A regular file gets a swap file, and the changes a crash left in it are replayed
+//A file that can't be opened leaves an empty document, named after it when it does not exist yet
+void editorOpen(char *filename)
+{
+	free(Editor.filename);
+	Editor.filename = strdup(filename);
+	editorSelectSyntax();
+
+	int fd = open(filename, O_RDONLY);
+	if(fd == -1)
+	{
+		editorSetStatusMessage("Can't open %s: %s", filename, strerror(errno));
+		if(errno != ENOENT)		//saving must not replace a file it could not read
+		{
+			free(Editor.filename);
+			Editor.filename = NULL;
+			editorSelectSyntax();
+		}
+		return;
+	}
+
+	struct stat st;
+	int regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+	struct fileCache *file = regular && st.st_size > 0 ? fileOpen(filename, fd, &st) : NULL;
+	if(file)
+	{
+		close(fd);
+		if(file->size >= viewerThreshold)
+		{
+			viewerOpen(file);
+			return;		//never changed, no swap file
+		}
+		editorOpenMapped(file);
+	}
+	else
+		editorOpenStream(fd);
+	if(regular)
+		swapOpen();
+}
+
+//Rows of a mapped file point straight into the mapping
+//Nothing is copied until a row is edited, see editorRowReserve()
+//A version of the file loaded before gets its rows from the line index at once
+void editorOpenMapped(struct fileCache *file)
+{
+	Editor.file = file;
+	Editor.map = file->map;
+	Editor.mapSize = file->size;
+	if(file->indexed == file->size)
+	{
+		fileLoadRows(file);
+		return;
+	}
+	file->numLines = 0;		//a load that was cut short starts over
+	file->indexed = 0;
+	madvise(Editor.map, Editor.mapSize, MADV_SEQUENTIAL);
+
+	Editor.loading = 1;
+	Editor.loadFd = -1;
+	Editor.loadOffset = 0;
+	Editor.loadRow = Editor.numRows;
+	Editor.dirty = 0;
+	editorAddTask(editorLoadStep);
+}
+
+//Reads rows from a pipe or device as the data arrives
+void editorOpenStream(int fd)
+{
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	Editor.loading = 1;
+	Editor.loadFd = fd;
+	Editor.loadOffset = 0;
+	Editor.loadRow = Editor.numRows;
+	Editor.loadLineLen = 0;
+	Editor.dirty = 0;
+	editorWatchFd(fd, editorLoadReadable);
+}
+
+void editorLoadReadable(int fd)
+{
+	(void) fd;
+	editorLoadStep();
+}
+
+//Adds a loaded line after the rows loaded so far
+//editorNewRow() moves Editor.loadRow past it, as it does for rows the user inserts before that point
+void editorLoadRow(char *line, size_t len, int mapped)
+{
+	while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+		len--;
+
+	if(mapped)
+	{
+		erow *row = editorNewRow(Editor.loadRow);
+		row->chars = line;
+		row->size = len;
+		wrapUpdateRow(row);
+		offsetUpdateRow(row);
+	}
+	else
+	{
+		Editor.loadingRow = 1;
+		editorInsertRow(Editor.loadRow, line, len);
+		Editor.loadingRow = 0;
+	}
+}
+
+void editorLoadFinish()
+{
+	editorRemoveTask(editorLoadStep);
+	if(Editor.loadFd != -1)
+	{
+		editorUnwatchFd(Editor.loadFd);
+		close(Editor.loadFd);
+	}
+	else
+		madvise(Editor.map, Editor.mapSize, MADV_NORMAL);
+
+	free(Editor.loadLine);
+	Editor.loadLine = NULL;
+	Editor.loadLineLen = 0;
+	Editor.loadLineCap = 0;
+	Editor.loadFd = -1;
+	Editor.loading = 0;
+}
+
+//Indexes up to "limit" more bytes of the mapping
+size_t editorLoadMapped(size_t limit)
+{
+	char *p = Editor.map + Editor.loadOffset;
+	char *end = Editor.map + Editor.mapSize;
+	char *stop = (size_t)(end - p) > limit ? p + limit : end;
+	int index = Editor.file->indexed == Editor.loadOffset;	//this load builds the line index
+
+	while(p < stop)
+	{
+		char *newLine = memchr(p, '\n', end - p);
+		char *lineEnd = newLine ? newLine : end;
+
+		editorLoadRow(p, lineEnd - p, 1);
+		p = newLine ? newLine + 1 : end;
+		if(index)
+			fileIndexRow(Editor.file, editorRowAt(Editor.loadRow - 1), p - Editor.map);
+	}
+
+	size_t done = p - (Editor.map + Editor.loadOffset);
+	Editor.loadOffset = p - Editor.map;
+	if(p == end)
+		editorLoadFinish();
+	return done;
+}
+
+//Reads whatever the stream has available, keeping a partial last line for the next call
+//Returns 0 when there is nothing to read right now
+size_t editorLoadStream(size_t limit)
+{
+	char buf[65536];
+	size_t done = 0;
+
+	while(done < limit)
+	{
+		ssize_t nRead = read(Editor.loadFd, buf, sizeof(buf));
+		if(nRead == -1)
+		{
+			if(errno == EAGAIN || errno == EINTR)
+				return done;
+			editorSetStatusMessage("Read error: %s", strerror(errno));
+			nRead = 0;
+		}
+		if(nRead == 0)
+		{
+			if(Editor.loadLineLen)
+				editorLoadRow(Editor.loadLine, Editor.loadLineLen, 0);
+			editorLoadFinish();
+			return done;
+		}
+
+		char *p = buf;
+		char *end = buf + nRead;
+		while(p < end)
+		{
+			char *newLine = memchr(p, '\n', end - p);
+			size_t len = (newLine ? newLine : end) - p;
+
+			if(newLine && Editor.loadLineLen == 0)
+				editorLoadRow(p, len, 0);
+			else
+			{
+				if(Editor.loadLineLen + len > Editor.loadLineCap)
+				{
+					Editor.loadLineCap = (Editor.loadLineLen + len) * 2;
+					Editor.loadLine = realloc(Editor.loadLine, Editor.loadLineCap);
+					if(Editor.loadLine == NULL)
+						die("realloc");
+				}
+				memcpy(&Editor.loadLine[Editor.loadLineLen], p, len);
+				Editor.loadLineLen += len;
+
+				if(newLine)
+				{
+					editorLoadRow(Editor.loadLine, Editor.loadLineLen, 0);
+					Editor.loadLineLen = 0;
+				}
+			}
+			p = newLine ? newLine + 1 : end;
+		}
+		done += nRead;
+		Editor.loadOffset += nRead;
+	}
+	return done;
+}
+
+//Loads rows for about LOAD_BUDGET_MS so the screen can be refreshed in between
+//Loading does not count as a modification, edits made meanwhile still do
+//Returns 1 while there is more to load
+int editorLoadStep()
+{
+	struct timespec start, now;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int dirty = Editor.dirty;
+
+	while(Editor.loading)
+	{
+		size_t done = Editor.loadFd == -1 ? editorLoadMapped(LOAD_CHUNK) : editorLoadStream(LOAD_CHUNK);
+		if(done == 0)
+			break;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 >= LOAD_BUDGET_MS)
+			break;
+	}
+	Editor.dirty = dirty;
+	return Editor.loading;
+}
+
+void editorOpenPromptFile()
+{
+	char *filename = editorPrompt("File name: %s", NULL, 0);
+	if(filename)
+	{
+		bufferOpen(filename);
+		editorRefreshScreen();
+		free(filename);
+	}
+}
+
+void editorSetLineNumber()
+{
+	char* type = editorPrompt("Type (absolute/relative/off): %s", NULL, 0);
+
+	if(type)
+	{
+		if(strcmp(type, "abs") == 0)
+			Editor.typeLineNumber = ABSOLUTE;
+		if(strcmp(type, "rel") == 0)
+			Editor.typeLineNumber = RELATIVE;
+		if(strcmp(type, "off") == 0)
+			Editor.typeLineNumber = OFF;
+		free(type);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Input	***///
+//*************///
+
+//Reads a line in the message bar, "callback" sees the text after every key
+//Returns NULL on ESC, an empty line is only accepted with "allowEmpty"
+char *editorPrompt(char* prompt, void(*callback)(char*, int), int allowEmpty)
+{
+	size_t bufferSize = 128;
+	char *buf = malloc(bufferSize);
+
+	size_t bufferLen = 0;
+	buf[0] = '\0';
+
+	while(1)
+	{
+		editorSetStatusMessage(prompt, buf);
+		editorRefreshScreen();
+		int c = editorReadKey();
+
+		if(c == DEL_KEY || c == CTRL_KEY('h') || c == BACKSPACE)
+		{
+			if(bufferLen != 0)
+				buf[--bufferLen] = '\0';
+		}
+		else if(c == '\x1b')
+		{
+			editorSetStatusMessage("");
+			if(callback)
+				callback(buf, c);
+			free(buf);
+			return NULL;
+		}
+		else if(c == '\r')
+		{
+			if(bufferLen != 0 || allowEmpty)
+			{
+				editorSetStatusMessage("");
+				if(callback)
+					callback(buf, c);
+				return buf;
+			}
+		}
+		else if (!iscntrl(c) && c < 128)
+		{
+			if(bufferLen == bufferSize - 1)
+			{
+				bufferSize *= 2;
+				buf = realloc(buf, bufferSize);
+			}
+			buf[bufferLen++] = c;
+			buf[bufferLen] = '\0';
+		}
+		if(callback)
+			callback(buf, c);
+	}
+}
+
+//Processes key
+//Arrows move, Page UP and DOWN move a screen, CTRL G goes to a line or byte offset
+void editorProcessKeyPress()
+{
+	int c = editorReadKey();
+	if(Editor.viewer && viewerKey(c))
+		return;
+	undoBegin();
+	static int quit_times = QUIT_TIMES;
+
+	switch(c)
+	{
+		case '\r':
+			editorInsertNewLine();
+			break;
+		case CTRL_KEY('q'):
+			{
+				
+				if(Editor.dirty && quit_times > 0)
+				{
+					editorSetStatusMessage("File unchanged! Press CTRL Q %d more times to quit.", quit_times);
+					quit_times--;
+					return;
+				}
+				if(editorCloseBuffer())
+					break;
+				editorFinishSave();
+				swapStop();
+				clearAndReposition();
+				exit(0);
+			}
+			break;	
+		case CTRL_KEY('s'):
+			editorSave();
+			break;
+		case CTRL_KEY('o'):
+			editorOpenPromptFile();
+			break;
+		case CTRL_KEY('k'):
+			editorSetLineNumber();
+			break;
+		case CTRL_KEY('f'):
+			editorFind(0);
+			break;
+		case CTRL_KEY('e'):
+			editorFind(1);
+			break;
+		case CTRL_KEY('r'):
+			editorReplace();
+			break;
+		case CTRL_KEY('z'):
+			editorUndo();
+			break;
+		case CTRL_KEY('y'):
+			editorRedo();
+			break;
+		case CTRL_KEY('n'):
+			editorSwitchBuffer(1);
+			break;
+		case CTRL_KEY('p'):
+			editorSwitchBuffer(-1);
+			break;
+		case HOME_KEY:
+			Editor.cursorX = 0;
+			break;
+		case END_KEY:
+			if(Editor.cursorY < Editor.numRows)
+				Editor.cursorX = editorRowAt(Editor.cursorY)->size;	
+			break;
+		case BACKSPACE:
+		case DEL_KEY:
+			if(c == DEL_KEY)
+				editorMoveCursor(ARROW_RIGHT);
+			editorDelChar();
+			break;
+		case PAGE_UP:
+		case PAGE_DOWN:
+			pageUpDown(c);
+			break;
+		case ARROW_RIGHT:
+		case ARROW_DOWN:
+		case ARROW_LEFT:
+		case ARROW_UP:
+			editorRefreshScreen();
+			editorMoveCursor(c);
+			break;
+		case PASTE:
+			editorInsertText(Editor.paste.buffer, Editor.paste.len);
+			break;
+		case CTRL_KEY('w'):
+			editorViewCommand();
+			break;
+		case CTRL_KEY('t'):
+			Editor.showFrameStats = !Editor.showFrameStats;
+			viewInvalidate();
+			break;
+		case CTRL_KEY('g'):
+			editorGoTo();
+			break;
+		case CTRL_KEY('u'):
+			editorToggleWrap();
+			break;
+		case CTRL_KEY('l'):
+			Editor.shadowValid = 0;		//repaint everything
+			viewInvalidate();
+			break;
+		case '\x1b':
+			break;
+		default:
+			editorInsertChar(c);
+			break;
+	}
+
+	quit_times = QUIT_TIMES;
+}
+
+//Moves the cursor a screen past the top or bottom of the view, editorScroll() follows it
+void pageUpDown(int c)
+{
+	if(Editor.softWrap)
+	{
+		int top = wrapTopLine();
+		wrapMoveCursor(c == PAGE_UP ? top - Editor.screenRows : top + Editor.screenRows * 2 - 1);
+		return;
+	}
+
+	if(c == PAGE_UP)
+		Editor.cursorY = Editor.rowOffset - Editor.screenRows;
+	else
+		Editor.cursorY = Editor.rowOffset + Editor.screenRows * 2 - 1;
+	if(Editor.cursorY < 0)
+		Editor.cursorY = 0;
+	if(Editor.cursorY > Editor.numRows)
+		Editor.cursorY = Editor.numRows;
+
+	int rowLen = Editor.cursorY < Editor.numRows ? editorRowAt(Editor.cursorY)->size : 0;
+	if(Editor.cursorX > rowLen)
+		Editor.cursorX = rowLen;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//** Output  **///
+//*************///
+
+int addLineNumber(struct appendBuffer *ab, int posY)
+{
+	char* numRowsToASCII = itoa(Editor.numRows, 10);
+	int numDigitsPadding = strlen(numRowsToASCII);
+
+	char lineNumber[32];
+
+	int numAbs = abs(posY - Editor.cursorY);
+
+	if(Editor.typeLineNumber == ABSOLUTE)
+		sprintf(lineNumber, "%*d", numDigitsPadding, posY); 	//%*d, relativePadding, d
+	else if(Editor.typeLineNumber == RELATIVE)
+	{
+		if(numAbs)
+			sprintf(lineNumber, "%*d", numDigitsPadding, numAbs);
+		else
+			sprintf(lineNumber, "%*d", numDigitsPadding, posY);			
+	}
+
+	appendBufferAppend(ab, lineNumber, numDigitsPadding);
+	return numDigitsPadding;
+}
+
+//Draws text line "y" of the view, the caller positions the cursor and clears the rest of the line
+//Returns the columns drawn, at most Editor.screenColumns
+int editorDrawRow(struct appendBuffer *ab, int y)
+{
+	int fileRow = y + Editor.rowOffset;
+	int segment = 0;	//line of the row, with soft wrap
+	int printTilde = 1;
+	int numberWidth = 0;
+
+	if(Editor.softWrap)
+		fileRow = wrapRowAt(wrapTopLine() + y, &segment);
+
+	if(Editor.typeLineNumber != -1 && fileRow < Editor.numRows)
+	{
+		printTilde = 0;
+		if(segment)
+		{
+			numberWidth = strlen(itoa(Editor.numRows, 10));
+			appendBufferAppend(ab, "                ", numberWidth);
+		}
+		else
+			numberWidth = addLineNumber(ab, fileRow);
+		Editor.cursorStartingColumn = 4;
+	}
+
+	if(fileRow >= Editor.numRows)
+	{
+		if(Editor.numRows == 0 && y == Editor.screenRows / 3)
+		{
+			char welcome[80];
+			int welcomelen = snprintf(welcome, sizeof(welcome),
+				"smk editor -- version %s", VERSION);
+			if(welcomelen > Editor.screenColumns)
+				welcomelen = Editor.screenColumns;
+
+			int padding = (Editor.screenColumns - welcomelen) / 2;
+
+			if(padding)
+			{
+				appendBufferAppend(ab, "~", 1);
+				padding--;
+			}
+
+			while(padding--)
+				appendBufferAppend(ab, " ", 1);
+
+			appendBufferAppend(ab, welcome, welcomelen);
+			return (Editor.screenColumns - welcomelen) / 2 + welcomelen;
+		} 
+		else if(printTilde)
+		{
+			appendBufferAppend(ab, "~", 1);
+			return 1;
+		}
+		return 0;
+	}	
+	else
+	{
+		//tabs are expanded here, only for the columns on screen
+		erow *row = editorRowAt(fileRow);
+		int startX = Editor.softWrap ? segment * (Editor.screenColumns - numberWidth) : Editor.columnOffset;
+		int x = startX;
+		int endX = startX + Editor.screenColumns - numberWidth;
+		int first = editorRowRenderXToCursorX(row, x);
+		int last = editorRowRenderXToCursorX(row, endX);
+		int len = (last < row->size ? last + 1 : row->size) - first;
+		char *c = &row->chars[first];
+
+		//colors
+		unsigned char marked[len + 1];
+		unsigned char *hl = searchMarkRow(fileRow, row->highLight ? &row->highLight[first] : NULL,
+					marked, first, len);
+		int currentColor = -1;
+
+		//each run of characters with the same color is appended at once
+		int j = 0;
+		while(j < len && x < endX)
+		{
+			int type = hl ? hl[j] : HL_NORMAL;
+			int color = type == HL_NORMAL ? -1 : editorSyntaxToColor(type);
+			int end = j + 1;
+			int width = 1;
+			if(c[j] == '\t')
+				width = TAB_SIZE - x % TAB_SIZE;
+			else
+			{
+				while(end < len && end - j < endX - x && c[end] != '\t' && (hl ? hl[end] : HL_NORMAL) == type)
+					end++;
+				width = end - j;
+			}
+			if(x + width > endX)
+				width = endX - x;
+
+			if(color != currentColor)
+			{
+				if(color == -1)
+					appendBufferAppend(ab, "\x1b[39m", 5);	//white
+				else
+				{
+					char buf[16];
+					int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
+					appendBufferAppend(ab, buf, clen);
+				}
+				currentColor = color;
+			}
+			if(c[j] == '\t')
+				appendBufferAppend(ab, "        ", width);	//TAB_SIZE spaces
+			else
+				appendBufferAppend(ab, &c[j], width);
+			x += width;
+			j = end;
+		}
+		appendBufferAppend(ab, "\x1b[39m", 5);
+		return numberWidth + x - startX;
+	}
+}
+
+//Scrolls the text area of the focused view by "delta" rows and shifts the shadow frame to match
+//Rows that stay on screen then compare equal and only the ones scrolled into view are drawn
+//The view has to be as wide as the terminal
+void editorScrollShadow(struct appendBuffer *ab, int delta)
+{
+	int rows = Editor.screenRows;
+	int top = Editor.screenTop;
+	int count = abs(delta);
+	if(count >= rows)
+		return;
+
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "\x1b[%d;%dr", top + 1, top + rows);	//scroll region
+	appendBufferAppend(ab, buf, len);
+
+	if(delta > 0)
+	{
+		len = snprintf(buf, sizeof(buf), "\x1b[%d;1H", top + rows);
+		appendBufferAppend(ab, buf, len);
+		while(count--)
+			appendBufferAppend(ab, "\n", 1);	//line feed at the bottom margin scrolls up
+	}
+	else
+	{
+		len = snprintf(buf, sizeof(buf), "\x1b[%d;1H", top + 1);
+		appendBufferAppend(ab, buf, len);
+		while(count--)
+			appendBufferAppend(ab, "\x1bM", 2);	//reverse index at the top margin scrolls down
+	}
+	appendBufferAppend(ab, "\x1b[r", 3);
+
+	//rotate the shadow rows, the ones that wrap around are now blank on the terminal
+	struct appendBuffer *shadow = Editor.shadow + top;
+	struct appendBuffer moved[rows];
+	count = abs(delta);
+	if(delta > 0)
+	{
+		memcpy(moved, shadow, sizeof(*shadow) * count);
+		memmove(shadow, &shadow[count], sizeof(*shadow) * (rows - count));
+		memcpy(&shadow[rows - count], moved, sizeof(*shadow) * count);
+		for(len = rows - count; len < rows; ++len)
+			shadow[len].len = 0;
+	}
+	else
+	{
+		memcpy(moved, &shadow[rows - count], sizeof(*shadow) * count);
+		memmove(&shadow[count], shadow, sizeof(*shadow) * (rows - count));
+		memcpy(shadow, moved, sizeof(*shadow) * count);
+		for(len = 0; len < count; ++len)
+			shadow[len].len = 0;
+	}
+}
+
+void editorScroll()
+{
+	Editor.rowX = 0;
+
+	if(Editor.cursorY < Editor.numRows)
+		Editor.rowX = editorRowCursorXToRowX(editorRowAt(Editor.cursorY), Editor.cursorX);
+
+	if(Editor.softWrap)
+		wrapScroll();
+	else
+	{
+		if(Editor.cursorY < Editor.rowOffset)
+			Editor.rowOffset = Editor.cursorY;
+		if(Editor.cursorY >= Editor.rowOffset + Editor.screenRows)
+			Editor.rowOffset = Editor.cursorY - Editor.screenRows + 1; 
+
+		if(Editor.rowX < Editor.columnOffset)
+			Editor.columnOffset = Editor.rowX;
+		if(Editor.rowX >= Editor.columnOffset + Editor.screenColumns)
+			Editor.columnOffset = Editor.rowX - Editor.screenColumns + 1;
+	}
+
+	if(Editor.cursorStartingColumn)
+		Editor.cursorX = Editor.cursorStartingColumn;
+}
+
+//Draws every line of the screen and compares it with what was last sent to the terminal
+//Only lines that differ are written, so moving the cursor costs the status bar and a cursor move
+//The frame buffers live across frames, changed lines are written straight from the shadow
+//Lines are composed from what the views drew, see view.c
+void editorRefreshScreen() 
+{
+	editorScroll();
+	viewDraw();
+
+	int allocs = appendBufferAllocs;
+	int lines = Editor.terminalRows;	//views and message bar
+	int y;
+	if(Editor.shadowLines != lines)
+	{
+		for(y = 0; y < Editor.shadowLines; ++y)
+			appendBufferFree(&Editor.shadow[y]);
+		Editor.shadow = realloc(Editor.shadow, sizeof(struct appendBuffer) * lines);
+		Editor.frameRefs = realloc(Editor.frameRefs, sizeof(struct frameRef) * lines);
+		for(y = 0; y < lines; ++y)
+			Editor.shadow[y] = (struct appendBuffer) ABUF_INIT;
+		Editor.shadowLines = lines;
+		Editor.shadowValid = 0;
+	}
+
+	struct appendBuffer *ab = &Editor.frame;
+	struct appendBuffer *line = &Editor.frameLine;
+	int numRefs = 0;
+	char buf[32];
+
+	appendBufferReset(ab);
+	appendBufferAppend(ab, "\x1b[?25l", 6);
+	int header = ab->len;
+
+	int top = wrapTopLine();
+	if(Editor.shadowValid && top != Editor.shadowOffset && Editor.screenColumns == Editor.terminalColumns)
+		editorScrollShadow(ab, top - Editor.shadowOffset);
+
+	for(y = 0; y < lines; ++y)
+	{
+		appendBufferReset(line);
+		if(y < lines - 1)
+			viewComposeLine(line, y);
+		else
+			editorDrawMessageBar(line);
+
+		struct appendBuffer *last = &Editor.shadow[y];
+		if(Editor.shadowValid && line->len == last->len
+			&& (line->len == 0 || memcmp(line->buffer, last->buffer, line->len) == 0))
+			continue;
+
+		struct appendBuffer swap = *last;
+		*last = *line;
+		*line = swap;
+
+		int len = snprintf(buf, sizeof(buf), "\x1b[%d;1H", y + 1);
+		appendBufferAppend(ab, buf, len);
+		Editor.frameRefs[numRefs++] = (struct frameRef) {ab->len, last->buffer, last->len};
+		appendBufferAppend(ab, "\x1b[K", 3);
+	}
+	Editor.shadowValid = 1;
+	Editor.shadowOffset = top;
+
+	int changed = ab->len != header;
+	if(!changed)
+		appendBufferReset(ab);		//cursor is still visible, only move it
+
+	int cursorY = Editor.cursorY - Editor.rowOffset;
+	int cursorX = Editor.rowX - Editor.columnOffset;
+	if(Editor.softWrap)
+		wrapCursor(&cursorY, &cursorX);
+	snprintf(buf, sizeof(buf), "\x1b[%d;%dH", Editor.screenTop + cursorY + 1, Editor.screenLeft + cursorX + 1);
+	
+	appendBufferAppend(ab, buf, strlen(buf));
+	
+	if(changed)
+		appendBufferAppend(ab, "\x1b[?25h", 6);
+
+	//interleave the frame buffer with the shadow lines it refers to
+	struct iovec iov[2 * numRefs + 1];
+	int count = 0;
+	int at = 0;
+	Editor.frameBytes = ab->len;
+	for(y = 0; y < numRefs; ++y)
+	{
+		struct frameRef *ref = &Editor.frameRefs[y];
+		if(ref->at > at)
+			iov[count++] = (struct iovec) {ab->buffer + at, ref->at - at};
+		if(ref->len)
+			iov[count++] = (struct iovec) {(char *)ref->line, ref->len};
+		at = ref->at;
+		Editor.frameBytes += ref->len;
+	}
+	iov[count++] = (struct iovec) {ab->buffer + at, ab->len - at};
+
+	editorWriteFrame(iov, count);
+	Editor.frameAllocs = appendBufferAllocs - allocs;
+}
+
+void editorSetStatusMessage(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(Editor.statusmsg, sizeof(Editor.statusmsg), fmt, ap);
+	va_end(ap);
+	Editor.statusmsg_time = time(NULL);
+	editorSetTimer(STATUS_TIMEOUT * 1000, NULL);	//redraw once the message expires
+}
+
+//Returns the row at index "at", skipping over the gap in Editor.row
+erow *editorRowAt(int at)
+{
+	if(Editor.viewer)
+		return viewerRow(at);
+	if(at >= Editor.rowGap)
+		at += Editor.rowGapLen;
+	return &Editor.row[at];
+}
+
+//Inverse of editorRowAt()
+int editorRowIndex(erow *row)
+{
+	int at = row - Editor.row;
+	if(at >= Editor.rowGap)
+		at -= Editor.rowGapLen;
+	return at;
+}
+
+//Moves the gap so that it starts at row "at"
+//Costs the distance moved, so edits close to each other are amortized O(1)
+void editorMoveGap(int at)
+{
+	wrapMoveGap(at);
+	offsetMoveGap(at);
+	if(at < Editor.rowGap)
+		memmove(&Editor.row[at + Editor.rowGapLen], &Editor.row[at], sizeof(erow) * (Editor.rowGap - at));
+	else if(at > Editor.rowGap)
+		memmove(&Editor.row[Editor.rowGap], &Editor.row[Editor.rowGap + Editor.rowGapLen],
+				sizeof(erow) * (at - Editor.rowGap));
+	Editor.rowGap = at;
+}
+
+//Doubles the capacity of Editor.row, the rows after the gap are moved to the end
+void editorGrowGap()
+{
+	int capacity = Editor.numRows + Editor.rowGapLen;
+	int newCapacity = capacity ? capacity * 2 : 64;
+	wrapGrowGap(newCapacity);
+	offsetReset();		//built again when it is used
+	erow *new = realloc(Editor.row, sizeof(erow) * newCapacity);
+	if(new == NULL)
+		die("realloc");
+
+	int tail = capacity - Editor.rowGap - Editor.rowGapLen;
+	memmove(&new[newCapacity - tail], &new[Editor.rowGap + Editor.rowGapLen], sizeof(erow) * tail);
+	Editor.row = new;
+	Editor.rowGapLen = newCapacity - Editor.numRows;
+}
+
+//Makes room for at least "len" chars plus the terminating '\0', growing geometrically
+//A row with chars but no capacity still points into the file mapping and gets its own copy here
+void editorRowReserve(erow *row, int len)
+{
+	editorThawRow(row);
+	if(len < row->size)		//the chars there are kept
+		len = row->size;
+	if(len + 1 <= row->capacity)
+		return;
+
+	int capacity = row->capacity ? row->capacity : 16;
+	while(capacity < len + 1)
+		capacity *= 2;
+
+	char *new;
+	if(row->capacity == 0 && row->chars)
+	{
+		new = arenaAlloc(capacity);
+		memcpy(new, row->chars, row->size);
+		new[row->size] = '\0';
+	}
+	else
+		new = arenaResize(row->chars, row->capacity, capacity);
+
+	row->chars = new;
+	row->capacity = capacity;
+}
+
+//Opens an empty row at "at" and returns it, the caller fills in chars and size
+erow *editorNewRow(int at)
+{
+	editorMoveGap(at);
+	if(Editor.rowGapLen == 0)
+		editorGrowGap();
+
+	erow *row = &Editor.row[at];
+	Editor.rowGap++;
+	Editor.rowGapLen--;
+
+	row->size = 0;
+	row->capacity = 0;
+	row->chars = NULL;
+	row->highLight = NULL;
+	row->tabs = NULL;
+	row->numTabs = 0;
+	row->tabsIndexed = 0;
+	row->highlighted = 0;
+	row->stateKnown = 0;
+	row->hlSize = 0;
+	row->hlGeneration = ++Editor.highLightGeneration;	//no result queued for another row matches
+	row->hlQueued = 0;
+	row->hlJob = 0;
+	row->hlState = HL_STATE_NORMAL;
+	row->hlStateIn = HL_STATE_NORMAL;
+	row->saveSerial = 0;
+	wrapUpdateRow(row);
+	offsetUpdateRow(row);
+
+	Editor.numRows++;
+	Editor.dirty++;
+	editorHighlightChanged(at);
+	if(Editor.loading && at <= Editor.loadRow)
+		Editor.loadRow++;
+	return row;
+}
+
+//Inserts text to a row
+void editorInsertRow(int at, char *string, size_t len)
+{
+	if(at < 0 || at > Editor.numRows)
+		return;
+	undoRecord(UNDO_INSERT_ROW, at, 0, string, len, NULL, 0);
+
+	erow *row = editorNewRow(at);
+	editorRowReserve(row, len);
+	memcpy(row->chars, string, len);
+	row->chars[len] = '\0';
+	row->size = len;
+	wrapUpdateRow(row);
+	offsetUpdateRow(row);
+}
+
+void editorRowInsertChar(erow *row, int at, int c)
+{
+	if(at < 0 || at > row->size)
+		at = row->size;
+	char ch = c;
+	undoRecord(UNDO_INSERT, editorRowIndex(row), at, &ch, 1, NULL, 0);
+	editorRowReserve(row, row->size + 1);
+	memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
+	row->size++;
+	row->chars[at] = c;
+	editorUpdateRow(row);
+	Editor.dirty++;
+}
+
+//Inserts "len" chars at "at" with a single move of the rest of the row
+void editorRowInsertString(erow *row, int at, const char *s, size_t len)
+{
+	if(at < 0 || at > row->size)
+		at = row->size;
+	undoRecord(UNDO_INSERT, editorRowIndex(row), at, s, len, NULL, 0);
+	editorRowReserve(row, row->size + len);
+	memmove(&row->chars[at + len], &row->chars[at], row->size - at + 1);
+	memcpy(&row->chars[at], s, len);
+	row->size += len;
+	editorUpdateRow(row);
+	Editor.dirty++;
+}
+
+//Inserts text at the cursor, "\n", "\r" and "\r\n" start a new row
+//Costs one insert per line of text instead of one per character
+void editorInsertText(const char *s, size_t len)
+{
+	if(Editor.cursorY == Editor.numRows)
+		editorInsertRow(Editor.numRows, "", 0);
+
+	const char *end = s + len;
+	const char *line = s;
+	const char *lineEnd = line;
+	while(lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r')
+		lineEnd++;
+
+	editorRowInsertString(editorRowAt(Editor.cursorY), Editor.cursorX, line, lineEnd - line);
+	Editor.cursorX += lineEnd - line;
+	if(lineEnd == end)
+		return;
+
+	//the rest of the cursor row goes below the pasted lines
+	editorInsertNewLine();
+	while(1)
+	{
+		line = lineEnd + (lineEnd + 1 < end && lineEnd[0] == '\r' && lineEnd[1] == '\n' ? 2 : 1);
+		lineEnd = line;
+		while(lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r')
+			lineEnd++;
+		if(lineEnd == end)
+			break;
+
+		editorInsertRow(Editor.cursorY, (char *)line, lineEnd - line);
+		Editor.cursorY++;
+	}
+	editorRowInsertString(editorRowAt(Editor.cursorY), 0, line, lineEnd - line);
+	Editor.cursorX = lineEnd - line;
+}
+
+void editorInsertChar(int c)
+{
+	if(Editor.cursorY == Editor.numRows)	//cursor is on the tilde line after the end of the file
+		editorInsertRow(Editor.numRows, "", 0);
+	editorRowInsertChar(editorRowAt(Editor.cursorY), Editor.cursorX, c);
+	Editor.cursorX++;
+}
+
+void editorInsertNewLine()
+{
+	if(Editor.cursorX == 0)
+		editorInsertRow(Editor.cursorY, "", 0);
+	else
+	{
+		erow *row = editorRowAt(Editor.cursorY);
+		editorInsertRow(Editor.cursorY + 1, &row->chars[Editor.cursorX], row->size - Editor.cursorX);
+		row = editorRowAt(Editor.cursorY);
+		editorRowDelString(row, Editor.cursorX, row->size - Editor.cursorX);
+	}
+	Editor.cursorY++;
+	Editor.cursorX = 0;
+}
+
+void editorFreeRow(erow *row)
+{
+	editorThawRow(row);
+	arenaFree(row->tabs, sizeof(struct rowTab) * row->numTabs);
+	if(row->capacity)
+		arenaFree(row->chars, row->capacity);
+	arenaFree(row->highLight, row->hlSize);
+}
+
+//Deletes row by moving the gap over it
+void editorDelRow(int at)
+{
+	if(at < 0 || at >= Editor.numRows)
+		return;
+	erow *row = editorRowAt(at);
+	undoRecord(UNDO_DELETE_ROW, at, 0, row->chars, row->size, NULL, 0);
+	editorFreeRow(row);
+	editorMoveGap(at);
+	wrapSet(at + Editor.rowGapLen, NULL);		//the row goes into the gap
+	offsetSet(at + Editor.rowGapLen, NULL);
+	Editor.rowGapLen++;
+	Editor.numRows--;
+	editorHighlightChanged(at);
+	if(Editor.loading && at < Editor.loadRow)
+		Editor.loadRow--;
+	Editor.dirty++;
+}
+
+//Deletes a char from a row. A row is a erow* and char located at "at"
+void editorRowDelChar(erow *row, int at)
+{
+	if(at < 0 || at >= row->size)
+		return;
+	undoRecord(UNDO_DELETE, editorRowIndex(row), at, &row->chars[at], 1, NULL, 0);
+	editorRowReserve(row, row->size);
+	memmove(&row->chars[at], &row->chars[at + 1], row->size - at);
+	row->size--;
+	editorUpdateRow(row);
+	Editor.dirty++;
+}
+
+//Deletes "len" chars from "at" on
+void editorRowDelString(erow *row, int at, int len)
+{
+	if(at < 0 || len <= 0 || at + len > row->size)
+		return;
+	undoRecord(UNDO_DELETE, editorRowIndex(row), at, &row->chars[at], len, NULL, 0);
+	editorRowReserve(row, row->size);
+	memmove(&row->chars[at], &row->chars[at + len], row->size - at - len + 1);
+	row->size -= len;
+	editorUpdateRow(row);
+	Editor.dirty++;
+}
+
+//called to delete a char
+void editorDelChar()
+{
+	if(Editor.cursorY == Editor.numRows)
+		return;
+	if(Editor.cursorX == 0 && Editor.cursorY == 0)
+		return;
+
+	erow *row = editorRowAt(Editor.cursorY);
+	if(Editor.cursorX > 0)
+	{
+		editorRowDelChar(row, Editor.cursorX - 1);
+		Editor.cursorX--;
+	} 
+	else
+	{
+		Editor.cursorX = editorRowAt(Editor.cursorY - 1)->size;
+		editorRowAppendString(editorRowAt(Editor.cursorY - 1), row->chars, row->size);
+		editorDelRow(Editor.cursorY);
+		Editor.cursorY--;
+	}
+}
+
+//Replaces the whole text of the row, the caller marks the file dirty
+//Only the span between what the old and new text start and end with is recorded and copied
+void editorRowSetString(erow *row, const char *s, size_t len)
+{
+	int prefix = 0, suffix = 0;
+	int shorter = row->size < (int)len ? row->size : (int)len;
+	while(prefix < shorter && row->chars[prefix] == s[prefix])
+		prefix++;
+	while(suffix < shorter - prefix && row->chars[row->size - 1 - suffix] == s[len - 1 - suffix])
+		suffix++;
+	editorRowReplaceString(row, prefix, row->size - prefix - suffix, &s[prefix], len - prefix - suffix);
+}
+
+//Replaces "len" chars of the row from "at" with "newLen" chars of "s", the caller marks the
+//file dirty
+void editorRowReplaceString(erow *row, int at, int len, const char *s, int newLen)
+{
+	if(len == 0 && newLen == 0)
+		return;
+	undoRecord(UNDO_SET, editorRowIndex(row), at, &row->chars[at], len, s, newLen);
+	editorRowReserve(row, row->size - len + newLen);
+	memmove(&row->chars[at + newLen], &row->chars[at + len], row->size - at - len);
+	memcpy(&row->chars[at], s, newLen);
+	row->size += newLen - len;
+	row->chars[row->size] = '\0';
+	editorUpdateRow(row);
+}
+
+//appends remaining text from a row to the row above when deleting the first char of a line
+void editorRowAppendString(erow *row, char *s, size_t len)
+{
+	undoRecord(UNDO_INSERT, editorRowIndex(row), row->size, s, len, NULL, 0);
+	editorRowReserve(row, row->size + len);
+	memcpy(&row->chars[row->size], s, len);
+	row->size += len;
+	row->chars[row->size] = '\0';
+	editorUpdateRow(row);
+	Editor.dirty++;
+}
+
+//Marks the row as changed, its tabs are indexed and it is highlighted again when needed
+void editorUpdateRow(erow *row)
+{
+	row->tabsIndexed = 0;
+	row->highlighted = 0;
+	row->stateKnown = 0;
+	row->hlGeneration = ++Editor.highLightGeneration;
+	editorHighlightChanged(editorRowIndex(row));
+	wrapUpdateRow(row);
+	offsetUpdateRow(row);
+}
+
+//Indexes the tabs of the row, so columns map between chars and render with a binary search
+void editorIndexTabs(erow *row)
+{
+	if(row->tabsIndexed)
+		return;
+
+	const char *end = row->chars + row->size;
+	const char *tab = row->chars;
+	int count = 0;
+	while(row->size && (tab = memchr(tab, '\t', end - tab)))
+	{
+		count++;
+		tab++;
+	}
+
+	row->tabs = arenaResize(row->tabs, sizeof(struct rowTab) * row->numTabs, sizeof(struct rowTab) * count);
+	if(count)
+	{
+		int rowX = 0, last = 0, k = 0;
+		tab = row->chars;
+		while((tab = memchr(tab, '\t', end - tab)))
+		{
+			int at = tab - row->chars;
+			rowX += at - last;
+			rowX += TAB_SIZE - rowX % TAB_SIZE;
+			row->tabs[k++] = (struct rowTab) {at, rowX};
+			last = at + 1;
+			tab++;
+		}
+	}
+	row->numTabs = count;
+	row->tabsIndexed = 1;
+}
+
+int editorRowCursorXToRowX(erow *row, int cursorX)
+{
+	editorIndexTabs(row);
+
+	int low = 0, high = row->numTabs;	//count the tabs before cursorX
+	while(low < high)
+	{
+		int middle = low + (high - low) / 2;
+		if(row->tabs[middle].at < cursorX)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if(low == 0)
+		return cursorX;
+	return row->tabs[low - 1].end + cursorX - row->tabs[low - 1].at - 1;
+}
+
+//Returns the char that covers render column "renderX", row->size past the end of the row
+int editorRowRenderXToCursorX(erow *row, int renderX)
+{
+	editorIndexTabs(row);
+
+	int low = 0, high = row->numTabs;	//count the tabs that end at or before renderX
+	while(low < high)
+	{
+		int middle = low + (high - low) / 2;
+		if(row->tabs[middle].end <= renderX)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	int cursorX = low == 0 ? renderX : row->tabs[low - 1].at + 1 + renderX - row->tabs[low - 1].end;
+	if(low < row->numTabs && cursorX > row->tabs[low].at)
+		cursorX = row->tabs[low].at;	//inside the next tab
+	return cursorX < row->size ? cursorX : row->size;
+}
+
+//draws status bar, when a file is modified the dirty flag is 1 and thus showing (modified) on status bar
+void editorDrawStatusBar(struct appendBuffer *ab)
+{
+	appendBufferAppend(ab, "\x1b[7m", 4);
+	char status[80], rstatus[80];
+	int len = snprintf(status, sizeof(status), "%.20s %s - %d,%d",
+				Editor.filename ? Editor.filename : "[No Name]",
+				Editor.dirty ? "(modified)" : Editor.viewer ? "(viewer)" : "", Editor.cursorX, Editor.cursorY);
+	
+	int rlen;
+	if(Editor.viewer)
+		rlen = viewerStatus(rstatus, sizeof(rstatus));
+	else if(Editor.loading && Editor.loadFd == -1)
+		rlen = snprintf(rstatus, sizeof(rstatus), "loading %d%% | %d/%d lines",
+					(int)(Editor.loadOffset * 100 / Editor.mapSize), Editor.cursorY + 1, Editor.numRows);
+	else if(Editor.loading)
+		rlen = snprintf(rstatus, sizeof(rstatus), "loading %zuKB | %d/%d lines",
+					Editor.loadOffset / 1024, Editor.cursorY + 1, Editor.numRows);
+	else if(Editor.search.active)
+		rlen = snprintf(rstatus, sizeof(rstatus), "match %d/%d | %d/%d lines",
+					Editor.search.current + 1, Editor.search.numMatches, Editor.cursorY + 1, Editor.numRows);
+	else if(Editor.showFrameStats)
+		rlen = snprintf(rstatus, sizeof(rstatus), "frame %dB %d allocs | %d/%d lines",
+					Editor.frameBytes, Editor.frameAllocs, Editor.cursorY + 1, Editor.numRows);
+	else
+		rlen = snprintf(rstatus, sizeof(rstatus), "%s | %d/%d lines",
+					Editor.syntax ? Editor.syntax->filetype : "no ft", Editor.cursorY + 1, Editor.numRows);
+	if(len > Editor.screenColumns)
+		len = Editor.screenColumns;
+
+	appendBufferAppend(ab, status, len);
+	while(len < Editor.screenColumns)
+	{
+		if(Editor.screenColumns - len == rlen)
+		{
+			appendBufferAppend(ab, rstatus, rlen);
+			break;
+		}
+		appendBufferAppend(ab, " ", 1);
+		len++;
+	}
+	appendBufferAppend(ab, "\x1b[m", 3);
+}
+
+void editorDrawMessageBar(struct appendBuffer *ab)
+{
+	int msglen = strlen(Editor.statusmsg);
+	if(msglen > Editor.terminalColumns)
+		msglen = Editor.terminalColumns;
+	if(msglen && time(NULL) - Editor.statusmsg_time < STATUS_TIMEOUT)
+		appendBufferAppend(ab, Editor.statusmsg, msglen);	
+}
+
+void editorMoveCursor(int key)
+{
+	erow *row = (Editor.cursorY >= Editor.numRows) ? NULL : editorRowAt(Editor.cursorY);
+	switch(key)
+	{
+		case ARROW_LEFT:
+			if(Editor.cursorX != 0)
+				Editor.cursorX--;
+			else if(Editor.cursorY > 0)	//Go end of a line
+			{
+				Editor.cursorY--;
+				Editor.cursorX = editorRowAt(Editor.cursorY)->size;
+			}
+			break;
+		case ARROW_RIGHT:
+			if(row && Editor.cursorX < row -> size)
+				Editor.cursorX++;
+			else if(row && Editor.cursorX == row->size)		//Go to start of a line
+			{
+				Editor.cursorY++;
+				Editor.cursorX = Editor.cursorStartingColumn;
+			}
+			break;
+		case ARROW_UP:
+			if(Editor.softWrap)
+				wrapMoveCursor(wrapCursorLine() - 1);
+			else if(Editor.cursorY != 0)
+				Editor.cursorY--;
+			break;
+		case ARROW_DOWN:
+			if(Editor.softWrap)
+				wrapMoveCursor(wrapCursorLine() + 1);
+			else if(Editor.cursorY < Editor.numRows)
+				Editor.cursorY++;
+			break;
+	}
+
+	//Move cursor to end of a line
+	row = (Editor.cursorY >= Editor.numRows) ? NULL : editorRowAt(Editor.cursorY);
+	int rowLen = row ? row->size : 0;
+	if(Editor.cursorX > rowLen)
+		Editor.cursorX = rowLen;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Init	***///
+//*************///
+
+
+//Also closes the document open before, its rows go with the arena
+void initEditor()
+{
+	editorFinishSave();
+	swapStop();
+	if(Editor.loading)
+		editorLoadFinish();
+	viewerClose();
+	arenaFreeAll();
+	free(Editor.row);
+	free(Editor.filename);
+	fileRelease(Editor.file);
+	Editor.file = NULL;
+	Editor.map = NULL;
+	Editor.mapSize = 0;
+	Editor.cursorX = 0;
+	Editor.cursorY = 0;
+	Editor.numRows = 0;
+	Editor.cursorStartingColumn = 0;
+	Editor.typeLineNumber = -1;
+	Editor.rowOffset = 0;
+	Editor.rowX = 0;
+	Editor.columnOffset = 0;
+	Editor.wrapOffset = 0;
+	wrapReset();
+	offsetReset();
+	Editor.row = NULL;
+	Editor.rowGap = 0;
+	Editor.rowGapLen = 0;
+	Editor.filename = NULL;
+	Editor.statusmsg[0] = '\0';
+	Editor.statusmsg_time = 0;
+	Editor.dirty = 0;
+	Editor.lineNumberSize = 0;
+	Editor.syntax = NULL;
+	Editor.highLightFrom = 0;
+	Editor.highLightSync = 0;
+	Editor.highLightSyncEnd = 0;
+	undoClear();
+	Editor.undo.limit = UNDO_LIMIT;
+	Editor.undo.group++;	//past a group dropped in the document before
+}
+
+//Sets the size of the terminal, the views are laid out again
+void editorResize(int rows, int cols)
+{
+	Editor.terminalRows = rows;
+	Editor.terminalColumns = cols;
+	Editor.shadowValid = 0;
+	viewLayout();
+}
+
+
+
+char* itoa(int val, int base)
+{
+	
+	static char buf[32] = {0};
+	
+	int i = 30;
+	
+	for(; val && i ; --i, val /= base)
+	
+		buf[i] = "0123456789abcdef"[val % base];
+	
+	return &buf[i+1];
+	
+}
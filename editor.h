@@ -0,0 +1,565 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <regex.h>
+#include <pthread.h>
+#include <sys/file.h>
+
+#ifndef EDITOR_H_INCLUDED
+#define EDITOR_H_INCLUDED
+
+#define CTRL_KEY(k) ((k) & 0x1f) //CTRL + q to quit
+#define TAB_SIZE 8
+#define ARENA_STEP 16		//row memory comes in multiples of this
+#define ARENA_MAX 1024		//bigger blocks are malloc'ed one by one
+#define UNDO_LIMIT (64 << 20)		//bytes the undo journal may take
+#define WRAP_WIDTHS 2		//text widths a document keeps soft wrap counts for
+#define VIEWER_CHUNKS 32		//chunks of rows viewer mode keeps decoded
+
+//Special Keys, Starting at 1000 so to not intervere with other common keys 
+enum editorKey
+{
+	BACKSPACE = 127,
+	ARROW_LEFT = 1000,	//Setting this one on 1000 so that the others are 1001, 10002...
+	ARROW_RIGHT,
+	ARROW_UP,
+	ARROW_DOWN,
+	DEL_KEY,
+	HOME_KEY,
+	END_KEY,
+	PAGE_UP,
+	PAGE_DOWN,
+	PASTE		//bracketed paste, the text is in Editor.paste
+};
+
+enum editorHighlight
+{
+	HL_NORMAL = 0,
+	HL_COMMENT,
+	HL_KEYWORD1,
+	HL_KEYWORD2,
+	HL_STRING,
+	HL_NUMBER,
+	HL_MATCH
+};
+
+//What a line ends inside of, carried over to the next one
+enum editorHighlightState
+{
+	HL_STATE_NORMAL = 0,
+	HL_STATE_COMMENT
+};
+
+struct appendBuffer 
+{
+  char *buffer;
+  int len;
+  int capacity;
+};
+
+//Change of the document recorded by undoRecord()
+enum undoType
+{
+	UNDO_INSERT,		//text inserted into a row
+	UNDO_DELETE,
+	UNDO_INSERT_ROW,
+	UNDO_DELETE_ROW,
+	UNDO_SET			//a span of a row replaced
+};
+
+struct undoOp
+{
+	int type;
+	int row;
+	int at;
+	int len;		//bytes of text
+	int newLen;		//for UNDO_SET, bytes of the new text that follows
+	int cursorX;	//where the group started
+	int cursorY;
+	unsigned int group;		//key press that made the change
+	int text;		//offset in Editor.undo.text
+};
+
+//Undo journal, see undo.c
+struct editorUndo
+{
+	struct undoOp *ops;
+	int first;		//oldest operation kept
+	int numOps;		//operations done, the ones after were undone
+	int totalOps;
+	int capacity;
+	struct appendBuffer text;
+	int textFirst;	//bytes of text dropped with the operations before "first"
+	unsigned int group;
+	unsigned int dropGroup;		//too big to be kept, the rest of it is not recorded
+	int cursorX;	//cursor when the group started
+	int cursorY;
+	size_t limit;	//bytes, 0 turns the journal off
+	int paused;		//changes are not recorded while undoing or redoing
+};
+
+//Shadow line written in place after byte "at" of the frame buffer
+struct frameRef
+{
+	int at;
+	const char *line;
+	int len;
+};
+
+//Tab of a row, where it is in chars and the render column right after it
+struct rowTab
+{
+	int at;
+	int end;
+};
+
+//Keyword of a syntax, in the hash table built by syntaxBuild()
+struct syntaxKeyword
+{
+	const char *word;
+	int len;
+	int type;		//HL_KEYWORD1 or HL_KEYWORD2
+};
+
+//Filetype of the syntax database in syntax.c
+struct editorSyntax
+{
+	const char *filetype;
+	const char **filematch;		//".ext" matches the extension, anything else the whole file name
+	const char **keywords;		//a trailing '|' marks a type
+	const char *singleLineComment;
+	const char *multiLineStart;
+	const char *multiLineEnd;
+	const char *quotes;			//bytes that start and end a string
+	unsigned char classes[256];		//the rest is built by syntaxBuild()
+	struct syntaxKeyword *table;	//open addressing on syntaxHash()
+	unsigned int tableMask;
+	int maxKeywordLen;
+	int singleLineLen;
+	int multiLineStartLen;
+	int multiLineEndLen;
+};
+
+//Where a match of the search query starts, in chars
+struct searchMatch
+{
+	int row;
+	int col;
+	int len;
+};
+
+//Match index of editorFind(), sorted by position, see search.c
+struct editorSearch
+{
+	int active;		//the search prompt is open
+	int regex;		//the query is an extended regular expression
+	struct appendBuffer query;	//what the matches are for
+	struct searchMatch *matches;
+	int numMatches;
+	int capacity;
+	int current;	//match the cursor is on, -1 for none
+	int rows;		//Editor.numRows when the matches were collected
+	int originRow;	//cursor when the prompt was opened
+	int originCol;
+};
+
+//Allocator of the document's row memory, see arena.c
+struct rowArena
+{
+	void *free[ARENA_MAX / ARENA_STEP];		//freed blocks of each size, linked through their first bytes
+	char *chunks;	//linked through their first bytes
+	char *next;		//unused part of the newest chunk
+	char *end;
+	struct arenaBlock *large;
+};
+
+//Mapping of one version of a file, shared by the documents that open it, see buffer.c
+struct fileCache
+{
+	char *path;		//real path
+	dev_t device;
+	ino_t inode;
+	struct timespec mtime;
+	char *map;
+	size_t size;
+	struct iovec *lines;	//rows of the first load, for "indexed" bytes of the mapping
+	int numLines;
+	int linesCapacity;
+	size_t indexed;
+	int refs;		//documents using it
+	struct fileCache *next;
+};
+
+//Lines every row takes with soft wrap on, see wrap.c
+struct editorWrap
+{
+	int columns;	//of text a line, 0 while the counts are not kept
+	int *heights;	//lines of the row in each slot of Editor.row, 0 in the gap
+	int *tree;		//Fenwick tree over heights
+	int size;		//slots, Editor.numRows + Editor.rowGapLen
+};
+
+//Bytes before every row, see offset.c
+struct offsetIndex
+{
+	long long *tree;	//Fenwick tree over the bytes of each slot of Editor.row
+	int size;		//slots
+	int valid;		//0 while it has to be built again
+};
+
+//Struct for a row
+//chars is a slice of Editor.map while capacity is 0, see editorRowReserve()
+typedef struct erow
+{
+	int size;
+	int capacity;	//bytes allocated for chars, all row memory comes from Editor.arena
+	char *chars;
+	unsigned char *highLight;
+	struct rowTab *tabs;	//see editorIndexTabs()
+	int numTabs;
+	int tabsIndexed;	//tabs is up to date
+	int highlighted;	//highLight is up to date for a line starting in hlStateIn
+	int stateKnown;		//hlState is up to date
+	int hlSize;			//bytes in highLight, may lag behind size until it is highlighted
+	unsigned int hlGeneration;	//changes whenever highLight goes out of date
+	unsigned int hlQueued;	//generation last handed to the highlight worker
+	unsigned int hlJob;		//and the job that took it
+	unsigned char hlStateIn;
+	unsigned char hlState;	//state at the end of the line
+	unsigned int saveSerial;	//the save of that number may still be writing chars, see editorThawRow()
+} erow;
+
+//Rows of the file decoded in viewer mode, see viewer.c
+struct viewerChunk
+{
+	int first;		//row, -1 while the chunk is not used
+	int count;
+	unsigned int used;		//viewer clock when it was last looked at
+	erow *rows;
+};
+
+//File too big to load shown through a window of rows, see viewer.c
+struct editorViewer
+{
+	size_t *marks;		//byte where row VIEWER_LINES * j starts
+	int numMarks;
+	int marksCapacity;
+	size_t scanned;		//bytes looked at for new lines so far
+	size_t indexed;		//where the first row not counted yet starts
+	int indexing;		//viewerIndexStep() has more to count
+	struct viewerChunk chunks[VIEWER_CHUNKS];
+	struct viewerChunk *last;	//looked at last
+	unsigned int clock;
+	long long found;	//byte of the match of the search prompt, -1 for none
+	size_t origin;		//cursor when the prompt was opened
+	int softWrap;		//of the screen, viewer mode is not wrapped
+};
+
+struct editorConf
+{
+	int cursorX, cursorY;
+	int minCursorX;
+	int typeLineNumber;
+	int lineNumberSize;
+	int cursorStartingColumn;
+	int rowX;
+	int rowOffset;
+	int columnOffset;
+	int wrapOffset;		//with soft wrap, line of the row at rowOffset at the top of the view
+	int terminalRows;
+	int terminalColumns;
+	int screenTop;		//of the focused view, see view.c
+	int screenLeft;
+	int screenRows;
+	int screenColumns;
+	int numRows;
+	char* filename;
+	int dirty;		//edits since the file was last saved
+	char statusmsg[80];
+	time_t statusmsg_time;
+	struct appendBuffer *shadow;	//lines last written to the terminal
+	int shadowLines;
+	int shadowValid;	//0 forces a full repaint
+	int shadowOffset;	//rowOffset of the last frame
+	struct appendBuffer frame;	//reused by every editorRefreshScreen()
+	struct appendBuffer frameLine;
+	struct frameRef *frameRefs;
+	int frameBytes;		//written by the last frame
+	int frameAllocs;
+	int showFrameStats;
+	int softWrap;		//rows are wrapped in every view
+	struct appendBuffer paste;	//text of the last PASTE key
+	struct editorSearch search;
+	struct editorSyntax *syntax;	//NULL when the filetype is not known
+	unsigned int highLightGeneration;
+	unsigned int highLightJobs;		//handed to the highlight worker so far
+	unsigned int highLightDropped;	//newest job whose result was dropped
+	int highLightNow;	//rows are colored on this thread, for a document drawn without the focus
+	int highLightFrom;	//rows above this one have the right hlState
+	int highLightSync;	//far below highLightFrom rows are highlighted from a state assumed here
+	int highLightSyncEnd;	//up to this row
+	erow *row;		//gap buffer of rows, use editorRowAt()
+	struct editorWrap wrap[WRAP_WIDTHS];
+	int wrapUsed;	//counts of the view drawn now
+	struct offsetIndex offsets;
+	struct rowArena arena;
+	struct editorUndo undo;
+	struct saveJob *saving;		//save running in the background, see save.c
+	unsigned int saveSerial;	//saves started so far
+	int rowGap;		//index where the gap starts
+	int rowGapLen;
+	char *map;		//file mapping that unedited rows point into
+	size_t mapSize;
+	struct fileCache *file;		//that "map" belongs to
+	struct editorViewer *viewer;	//NULL unless the file is shown in viewer mode
+	struct swapFile *swap;		//see swap.c
+	int loading;	//editorLoadStep() still has rows to add
+	int loadingRow;		//editorLoadRow() is adding a row, that is not a change
+	int loadFd;		//stream being read, -1 when indexing Editor.map
+	size_t loadOffset;	//bytes loaded so far
+	int loadRow;	//where the next loaded row goes
+	char *loadLine;	//partial line read from the stream
+	size_t loadLineLen;
+	size_t loadLineCap;
+	struct termios orig_termios;
+};
+
+extern struct editorConf Editor;
+extern size_t viewerThreshold;		//files from this size on are opened in viewer mode
+extern int highlightPipe[2];		//readable when the highlight worker finished jobs
+
+//Provided by terminal.c, or by the benchmark when running without a terminal
+void die(const char *s);
+int editorReadKey();
+void clearAndReposition();
+void editorWriteFrame(struct iovec *iov, int count);
+
+void undoTrim();
+void swapOpen();
+void swapStop();
+void viewDraw();
+void viewSave();
+void undoBegin();
+void undoClear();
+void bufferNew();
+void wrapReset();
+void editorSave();
+void initEditor();
+void editorUndo();
+void editorRedo();
+size_t undoSize();
+int bufferIndex();
+void viewLayout();
+int wrapColumns();
+int wrapPrepare();
+int wrapTopLine();
+void wrapScroll();
+void editorGoTo();
+void viewerFind();
+void searchClear();
+void offsetBuild();
+void offsetReset();
+void viewerClose();
+void bufferLeave();
+void editorScroll();
+void arenaFreeAll();
+void bufferStatus();
+void bufferResume();
+void editorDelChar();
+void editorGrowGap();
+int editorLoadStep();
+void editorReplace();
+int wrapCursorLine();
+int viewerKey(int c);
+long long editorNow();
+void editorArmTimer();
+void viewInvalidate();
+int viewerIndexStep();
+void pageUpDown(int c);
+void editorRunTimers();
+void swapSaveStarted();
+void viewEnter(int at);
+void viewLeave(int at);
+void editorCloseView();
+int wrapLineOf(int at);
+void viewFocus(int at);
+void editorLoadFinish();
+void editorRunSignals();
+void editorFinishSave();
+void fileTrim(int keep);
+int editorCloseBuffer();
+int viewNew(int buffer);
+void editorToggleWrap();
+erow *viewerRow(int at);
+void editorViewCommand();
+void wrapMoveGap(int at);
+void editorDelRow(int at);
+erow *editorRowAt(int at);
+void editorSelectSyntax();
+void saveReadable(int fd);
+void *saveWork(void *arg);
+void *swapWork(void *arg);
+void bufferSwitch(int at);
+void saveWatch(int watch);
+void editorSetLineNumber();
+void editorInsertNewLine();
+void editorRefreshScreen();
+void editorMoveGap(int at);
+erow *editorNewRow(int at);
+void editorFind(int regex);
+void *regexWork(void *arg);
+struct swapFile *swapGet();
+long long offsetOf(int at);
+void offsetMoveGap(int at);
+void viewerMark(size_t at);
+void editorOpenPromptFile();
+int arenaClass(size_t size);
+void editorProcessKeyPress();
+void editorInsertChar(int c);
+void editorUnwatchFd(int fd);
+void viewerIndexRows(int at);
+void editorFreeRow(erow *row);
+char* itoa(int val, int base);
+void editorOpenStream(int fd);
+int editorRowIndex(erow *row);
+void editorStartHighlighter();
+void *arenaAlloc(size_t size);
+void editorThawRow(erow *row);
+void viewBufferClosed(int at);
+void wrapMoveCursor(int line);
+void wrapUpdateRow(erow *row);
+void viewerIndexTo(size_t at);
+void editorMoveCursor(int key);
+void *highlightWork(void *arg);
+void highlightReadable(int fd);
+void wrapGrowGap(int capacity);
+int swapLock(const char *path);
+void editorUpdateRow(erow *row);
+void editorOpen(char *filename);
+void editorLoadReadable(int fd);
+void editorIndexTabs(erow *row);
+void bufferOpen(char *filename);
+void editorFocusView(int delta);
+void wrapCursor(int *y, int *x);
+void offsetUpdateRow(erow *row);
+void swapSaveFinished(int saved);
+struct editorWrap *wrapCurrent();
+void offsetJump(int row, int at);
+size_t viewerIndex(size_t limit);
+long long viewerOffsetOf(int at);
+void editorAddTask(int (*step)());
+void editorSignalHandler(int sig);
+void wrapSet(int slot, erow *row);
+int offsetRowAt(long long offset);
+int viewerRowAt(long long offset);
+void editorUpdateSyntax(erow *row);
+void editorSwitchBuffer(int delta);
+void editorSplitView(int vertical);
+void regexFind(const char *pattern);
+void editorHighlightChanged(int at);
+void offsetSet(int slot, erow *row);
+void editorRemoveTask(int (*step)());
+void arenaFree(void *p, size_t size);
+int bufferFind(const char *filename);
+size_t editorLoadMapped(size_t limit);
+size_t editorLoadStream(size_t limit);
+void editorResize(int rows, int cols);
+int editorWaitFd(int fd, int timeout);
+int searchFirstFrom(int row, int col);
+int wrapRowAt(int line, int *segment);
+int editorSyntaxToColor(int highLight);
+char *swapPathFor(const char *filename);
+struct editorView *viewAt(int y, int x);
+void viewerDrop(size_t from, size_t to);
+void viewerOpen(struct fileCache *file);
+void editorRowDelChar(erow *row, int at);
+void fileRelease(struct fileCache *file);
+void editorRowReserve(erow *row, int len);
+void fileLoadRows(struct fileCache *file);
+int wrapRowHeight(erow *row, int columns);
+void offsetAdd(int slot, long long delta);
+void editorHighlightRow(erow *row, int at);
+void swapStart(struct appendBuffer *since, int fd);
+void searchScan(const char *query, int len);
+void undoApply(struct undoOp *op, int redo);
+void viewDrawLines(struct editorView *view);
+void wrapBuildTree(struct editorWrap *wrap);
+int viewerStatus(char *status, size_t size);
+void bufferShow(struct editorConf *document);
+void editorFindCallback(char *query, int key);
+void searchNarrow(const char *query, int len);
+void searchUpdate(const char *query, int len);
+void editorHighlightRows(int first, int last);
+void syntaxBuild(struct editorSyntax *syntax);
+void editorOpenMapped(struct fileCache *file);
+void viewerFindCallback(char *query, int key);
+void appendBufferFree(struct appendBuffer *ab);
+void searchAddMatch(int row, int col, int len);
+void saveSyncDir(const char *path, int dirLen);
+void appendBufferReset(struct appendBuffer *ab);
+void editorSetTimer(int ms, void (*callback)());
+unsigned int syntaxHash(const char *s, int len);
+void editorInsertText(const char *s, size_t len);
+void editorSetStatusMessage(const char *fmt, ...);
+void editorDrawStatusBar(struct appendBuffer *ab);
+void editorRowInsertChar(erow *row, int at, int c);
+int editorRowCursorXToRowX(erow *row, int cursorX);
+void editorDrawMessageBar(struct appendBuffer *ab);
+int editorDrawRow(struct appendBuffer *ab, int y);
+int writeAll(int fd, struct iovec *iov, int count);
+void editorWatchSignal(int sig, void (*callback)());
+void editorRowDelString(erow *row, int at, int len);
+void wrapMoveSlots(struct editorWrap *wrap, int at);
+void editorWatchFd(int fd, void (*callback)(int fd));
+void viewComposeLine(struct appendBuffer *ab, int y);
+int editorRowRenderXToCursorX(erow *row, int renderX);
+int addLineNumber(struct appendBuffer *ab, int posY);
+void editorInsertRow(int at, char *string, size_t len);
+void editorLoadRow(char *line, size_t len, int mapped);
+void *arenaResize(void *p, size_t size, size_t newSize);
+void editorRowAppendString(erow *row, char *s, size_t len);
+void wrapAdd(struct editorWrap *wrap, int slot, int delta);
+void viewerLoadChunk(struct viewerChunk *chunk, int first);
+void editorScrollShadow(struct appendBuffer *ab, int delta);
+int swapReplay(const char *data, size_t size, size_t *used);
+void editorRowSetString(erow *row, const char *s, size_t len);
+ssize_t saveWriteRows(int fd, struct iovec *rows, int numRows);
+struct viewNode *viewNewNode(int view, struct viewNode *parent);
+int swapMatches(const char *data, size_t size, struct stat *st);
+int undoMerge(int type, int row, int at, const char *s, int len);
+void fileIndexRow(struct fileCache *file, erow *row, size_t end);
+int syntaxKeyword(struct editorSyntax *syntax, const char *s, int len);
+void appendBufferAppend(struct appendBuffer *ab, const char *s, int len);
+void editorRowInsertString(erow *row, int at, const char *s, size_t len);
+struct fileCache *fileOpen(const char *filename, int fd, struct stat *st);
+long long viewerMatch(const char *query, int len, size_t from, size_t to);
+char *editorPrompt(char* prompt, void(*callback)(char*, int), int allowEmpty);
+long long viewerLastMatch(const char *query, int len, size_t from, size_t to);
+long long viewerSearch(const char *query, int len, size_t from, int backward);
+void viewPlace(struct editorView *view, int top, int left, int rows, int columns);
+void editorRowReplaceString(erow *row, int at, int len, const char *s, int newLen);
+void viewLayoutNode(struct viewNode *node, int top, int left, int rows, int columns);
+const char *searchKernel(const char *haystack, size_t size, const char *needle, size_t len);
+void undoRecord(int type, int row, int at, const char *s, int len, const char *newS, int newLen);
+void swapRecord(int type, int row, int at, const char *s, int len, const char *newS, int newLen);
+int editorSyntaxLine(struct editorSyntax *syntax, const char *s, int len, unsigned char *hl, int state);
+unsigned char *searchMarkRow(int fileRow, unsigned char *highLight, unsigned char *marked, int from, int len);
+#endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "editor.h"
+
+#define MAX_WATCHES 16
+#define MAX_TASKS 8
+#define MAX_TIMERS 16
+
+//Descriptor watched by the event loop, the callback runs when it is readable
+struct editorWatch
+{
+	int fd;
+	void (*callback)(int fd);
+};
+
+//One-shot timer, a NULL callback only wakes the loop so the screen is redrawn
+struct editorTimer
+{
+	long long deadline;		//ms on the monotonic clock
+	void (*callback)();
+};
+
+struct editorWatch watches[MAX_WATCHES];
+int numWatches;
+int (*tasks[MAX_TASKS])();	//idle work, run while nothing else is ready
+int numTasks;
+struct editorTimer timers[MAX_TIMERS];
+int numTimers;
+int timerFd = -1;
+int signalPipe[2] = {-1, -1};
+void (*signalCallbacks[NSIG])();
+
+long long editorNow()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+void editorWatchFd(int fd, void (*callback)(int fd))
+{
+	if(numWatches == MAX_WATCHES)
+		die("too many watched descriptors");
+	watches[numWatches++] = (struct editorWatch) {fd, callback};
+}
+
+void editorUnwatchFd(int fd)
+{
+	int j;
+	for(j = 0; j < numWatches; ++j)
+		if(watches[j].fd == fd)
+			watches[j--] = watches[--numWatches];
+}
+
+//Adds work that runs in steps while the editor would otherwise be waiting
+//"step" returns 0 once it is done and is then dropped
+void editorAddTask(int (*step)())
+{
+	int j;
+	for(j = 0; j < numTasks; ++j)
+		if(tasks[j] == step)
+			return;
+	if(numTasks == MAX_TASKS)
+		die("too many tasks");
+	tasks[numTasks++] = step;
+}
+
+void editorRemoveTask(int (*step)())
+{
+	int j;
+	for(j = 0; j < numTasks; ++j)
+		if(tasks[j] == step)
+			tasks[j--] = tasks[--numTasks];
+}
+
+//Points the timerfd at the earliest deadline
+void editorArmTimer()
+{
+	if(timerFd == -1)
+		return;
+
+	struct itimerspec when = {{0, 0}, {0, 0}};
+	int j;
+	for(j = 0; j < numTimers; ++j)
+	{
+		long long at = timers[j].deadline;
+		long long armed = when.it_value.tv_sec * 1000LL + when.it_value.tv_nsec / 1000000;
+		if(j == 0 || at < armed)
+		{
+			when.it_value.tv_sec = at / 1000;
+			when.it_value.tv_nsec = (at % 1000) * 1000000 + 1;	//never 0, that disarms
+		}
+	}
+	timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &when, NULL);
+}
+
+//Runs "callback" once after "ms" milliseconds, a pending timer with the same callback is moved
+//to the new deadline instead of adding another
+void editorSetTimer(int ms, void (*callback)())
+{
+	if(timerFd == -1)
+		timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	int j;
+	for(j = 0; j < numTimers; ++j)
+		if(timers[j].callback == callback)
+			break;
+	if(j == MAX_TIMERS)
+		die("too many timers");
+	if(j == numTimers)
+		numTimers++;
+	timers[j] = (struct editorTimer) {editorNow() + ms, callback};
+	editorArmTimer();
+}
+
+void editorRunTimers()
+{
+	uint64_t expirations;
+	read(timerFd, &expirations, sizeof(expirations));
+
+	long long now = editorNow();
+	int j;
+	for(j = 0; j < numTimers; ++j)
+		if(timers[j].deadline <= now)
+		{
+			void (*callback)() = timers[j].callback;
+			timers[j--] = timers[--numTimers];
+			if(callback)
+				callback();
+		}
+	editorArmTimer();
+}
+
+void editorSignalHandler(int sig)
+{
+	int saved = errno;
+	unsigned char c = sig;
+	write(signalPipe[1], &c, 1);
+	errno = saved;
+}
+
+//Calls "callback" from the event loop, not from the signal handler, whenever "sig" arrives
+void editorWatchSignal(int sig, void (*callback)())
+{
+	if(signalPipe[0] == -1)
+	{
+		if(pipe(signalPipe) == -1)
+			die("pipe");
+		fcntl(signalPipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(signalPipe[1], F_SETFL, O_NONBLOCK);
+	}
+	signalCallbacks[sig] = callback;
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = editorSignalHandler;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	sigaction(sig, &sa, NULL);
+}
+
+void editorRunSignals()
+{
+	unsigned char sig;
+	while(read(signalPipe[0], &sig, 1) == 1)
+		if(signalCallbacks[sig])
+			signalCallbacks[sig]();
+}
+
+//Waits until "fd" is readable or "timeout" ms pass (-1 forever)
+//Meanwhile signals, timers and watched descriptors are handled as they come and idle tasks
+//run whenever nothing is ready; the screen is refreshed after any of them did something
+//Returns 1 when "fd" is readable
+int editorWaitFd(int fd, int timeout)
+{
+	long long deadline = editorNow() + timeout;
+
+	while(1)
+	{
+		struct pollfd fds[MAX_WATCHES + 3];
+		int nfds = 0;
+		int j;
+
+		fds[nfds++] = (struct pollfd) {fd, POLLIN, 0};
+		if(signalPipe[0] != -1)
+			fds[nfds++] = (struct pollfd) {signalPipe[0], POLLIN, 0};
+		if(timerFd != -1)
+			fds[nfds++] = (struct pollfd) {timerFd, POLLIN, 0};
+		int first = nfds;
+		int watched = numWatches;
+		for(j = 0; j < watched; ++j)
+			fds[nfds++] = (struct pollfd) {watches[j].fd, POLLIN, 0};
+
+		int wait = timeout;
+		if(timeout > 0)
+		{
+			long long left = deadline - editorNow();
+			wait = left > 0 ? left : 0;
+		}
+		if(numTasks && timeout != 0)
+			wait = 0;
+
+		int ready = poll(fds, nfds, wait);
+		if(ready == -1 && errno != EINTR)
+			die("poll");
+		if(ready > 0 && (fds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+			return 1;
+
+		int ran = 0;
+		for(j = 1; ready > 0 && j < nfds; ++j)
+		{
+			if(!(fds[j].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+			if(fds[j].fd == signalPipe[0] && j < first)
+				editorRunSignals();
+			else if(fds[j].fd == timerFd && j < first)
+				editorRunTimers();
+			else
+			{
+				int k;
+				for(k = 0; k < numWatches; ++k)		//the watch may be gone by now
+					if(watches[k].fd == fds[j].fd)
+					{
+						watches[k].callback(fds[j].fd);
+						break;
+					}
+			}
+			ran = 1;
+		}
+
+		if(ready == 0 && numTasks && timeout != 0)
+		{
+			int (*step)() = tasks[0];
+			editorRemoveTask(step);
+			if(step())
+				tasks[numTasks++] = step;	//round robin with the other tasks
+			ran = 1;
+		}
+
+		if(ran)
+			editorRefreshScreen();
+		if(timeout == 0 || (timeout > 0 && editorNow() >= deadline))
+			return 0;
+	}
+}
@@ -0,0 +1,166 @@
+#include "editor.h"
+
+//Byte offsets of the rows, for CTRL G going to a byte offset or a percentage of the file
+//A Fenwick tree over the slots of Editor.row has the bytes each row takes when saved, its chars and
+//the newline, 0 in the gap; like the soft wrap counts in wrap.c it follows the gap and the edits, so
+//the offset of a row and the row at an offset are O(log n)
+//It is built the first time it is used, which costs a pass over the rows but keeps that off opening
+//a file; a long move of the gap drops it the same way
+
+void offsetAdd(int slot, long long delta)
+{
+	struct offsetIndex *index = &Editor.offsets;
+	for(slot++; slot <= index->size; slot += slot & -slot)
+		index->tree[slot] += delta;
+}
+
+//Builds the tree from the rows in O(n)
+void offsetBuild()
+{
+	struct offsetIndex *index = &Editor.offsets;
+	int j;
+	index->size = Editor.numRows + Editor.rowGapLen;
+	index->tree = realloc(index->tree, sizeof(long long) * (index->size + 1));
+	if(index->tree == NULL)
+		die("realloc");
+	index->tree[0] = 0;
+	for(j = 0; j < index->size; ++j)
+		index->tree[j + 1] = j >= Editor.rowGap && j < Editor.rowGap + Editor.rowGapLen ? 0 : Editor.row[j].size + 1;
+	for(j = 1; j <= index->size; ++j)
+		if(j + (j & -j) <= index->size)
+			index->tree[j + (j & -j)] += index->tree[j];
+	index->valid = 1;
+}
+
+void offsetReset()
+{
+	free(Editor.offsets.tree);
+	Editor.offsets.tree = NULL;
+	Editor.offsets.size = 0;
+	Editor.offsets.valid = 0;
+}
+
+//Sets slot "slot" of Editor.row to the bytes of "row", 0 for NULL
+void offsetSet(int slot, erow *row)
+{
+	struct offsetIndex *index = &Editor.offsets;
+	if(!index->valid)
+		return;
+
+	long long bytes = index->tree[slot + 1];	//less the slots under it in the tree
+	int j;
+	for(j = slot; j > slot + 1 - ((slot + 1) & -(slot + 1)); j -= j & -j)
+		bytes -= index->tree[j];
+	offsetAdd(slot, (row ? row->size + 1 : 0) - bytes);
+}
+
+//The text of the row changed
+void offsetUpdateRow(erow *row)
+{
+	offsetSet(row - Editor.row, row);
+}
+
+//editorMoveGap() is about to move the gap to "at", the rows in between change slots
+void offsetMoveGap(int at)
+{
+	struct offsetIndex *index = &Editor.offsets;
+	if(!index->valid || at == Editor.rowGap)
+		return;
+
+	int from = at < Editor.rowGap ? at : Editor.rowGap + Editor.rowGapLen;
+	int to = at < Editor.rowGap ? at + Editor.rowGapLen : Editor.rowGap;
+	int count = at < Editor.rowGap ? Editor.rowGap - at : at - Editor.rowGap;
+	if(count > index->size / 32)
+	{
+		index->valid = 0;	//built again from the moved rows when it is used
+		return;
+	}
+	int j;
+	for(j = 0; j < count; ++j)
+		offsetAdd(from + j, -(Editor.row[from + j].size + 1));
+	for(j = 0; j < count; ++j)
+		offsetAdd(to + j, Editor.row[from + j].size + 1);
+}
+
+//Bytes before row "at", the size of the document for Editor.numRows
+long long offsetOf(int at)
+{
+	if(Editor.viewer)
+		return viewerOffsetOf(at);
+	struct offsetIndex *index = &Editor.offsets;
+	if(!index->valid)
+		offsetBuild();
+	int slot = at >= Editor.rowGap ? at + Editor.rowGapLen : at;
+	long long offset = 0;
+	for(; slot > 0; slot -= slot & -slot)
+		offset += index->tree[slot];
+	return offset;
+}
+
+//Row that has byte "offset", Editor.numRows past the end
+int offsetRowAt(long long offset)
+{
+	if(Editor.viewer)
+		return viewerRowAt(offset);
+	struct offsetIndex *index = &Editor.offsets;
+	if(!index->valid)
+		offsetBuild();
+	int slot = 0;
+	int bit = 1;
+	while(bit * 2 <= index->size)
+		bit *= 2;
+	for(; bit; bit /= 2)
+	{
+		if(slot + bit <= index->size && index->tree[slot + bit] <= offset)
+		{
+			slot += bit;
+			offset -= index->tree[slot];
+		}
+	}
+	if(slot >= index->size)
+		return Editor.numRows;
+	return slot >= Editor.rowGap + Editor.rowGapLen ? slot - Editor.rowGapLen : slot;
+}
+
+//Puts the cursor on char "at" of row "row" with the row in the middle of the view
+void offsetJump(int row, int at)
+{
+	if(Editor.viewer)
+		viewerIndexRows(row);
+	if(row > Editor.numRows)
+		row = Editor.numRows;
+	if(row < 0)
+		row = 0;
+	int rowLen = row < Editor.numRows ? editorRowAt(row)->size : 0;
+	Editor.cursorY = row;
+	Editor.cursorX = at < rowLen ? at : rowLen;
+	Editor.rowOffset = row > Editor.screenRows / 2 ? row - Editor.screenRows / 2 : 0;
+	Editor.wrapOffset = 0;
+}
+
+//CTRL G, goes to a line, "@" and a byte offset or a percentage of the bytes of the file
+void editorGoTo()
+{
+	char *target = editorPrompt("Go to: %s (line, @byte offset or percent%%, ESC to cancel)", NULL, 0);
+	if(target == NULL)
+		return;
+
+	char *digits = target[0] == '@' ? target + 1 : target;
+	char *end;
+	long long number = strtoll(digits, &end, 10);	//"010" is line 10, not 8
+	if(end == digits || (*end && strcmp(end, "%") != 0) || number < 0 || (*end == '%' && digits != target))
+		editorSetStatusMessage("Not a line, @offset or percentage: %s", target);
+	else if(target[0] == '@' || *end == '%')
+	{
+		long long size = offsetOf(Editor.numRows);
+		long long offset = *end == '%' ? (number >= 100 ? size : size * number / 100) : number;
+		if(offset > size)
+			offset = size;
+		int row = offsetRowAt(offset);
+		offsetJump(row, row < Editor.numRows ? offset - offsetOf(row) : 0);
+		editorSetStatusMessage("Byte %lld of %lld, line %d", offset, size, row + 1);
+	}
+	else
+		offsetJump(number > 0 ? (number - 1 < Editor.numRows ? number - 1 : Editor.numRows) : 0, 0);
+	free(target);
+}
@@ -0,0 +1,237 @@
+#include "editor.h"
+
+#define SAVE_BATCH 512		//rows written by one writev()
+
+//Save running on its own thread, it only reads "rows" and the strings it owns
+//Rows edited meanwhile get new chars from editorRowReserve(), the old ones wait in "released"
+struct saveJob
+{
+	struct iovec *rows;		//the document when the save started
+	int numRows;
+	int dirty;		//Editor.dirty at that point
+	char *path;
+	int dirLen;		//bytes of path naming its directory
+	char *temp;
+	mode_t mode;
+	long long start;
+	ssize_t written;	//-1 when the save failed
+	int error;
+	struct iovec *released;		//row memory to give back to the arena once the rows are written
+	int numReleased;
+	int releasedCapacity;
+	pthread_t thread;
+	int threaded;	//0 when the save ran on the UI thread
+	int pipe[2];	//the thread writes a byte when it is done
+};
+
+//Writes the rows to "fd", a batch of rows per writev()
+//Returns the bytes written or -1
+ssize_t saveWriteRows(int fd, struct iovec *rows, int numRows)
+{
+	struct iovec iov[SAVE_BATCH * 2];
+	ssize_t total = 0;
+	int j = 0;
+
+	while(j < numRows)
+	{
+		int count = 0;
+		for(; j < numRows && count < SAVE_BATCH * 2; ++j)
+		{
+			iov[count++] = rows[j];
+			iov[count++] = (struct iovec) {"\n", 1};
+			total += rows[j].iov_len + 1;
+		}
+		if(writeAll(fd, iov, count) == -1)
+			return -1;
+	}
+	return total;
+}
+
+//Makes a rename in the directory of "path" durable, "dirLen" bytes of it name the directory
+void saveSyncDir(const char *path, int dirLen)
+{
+	char *dir = dirLen ? strndup(path, dirLen) : strdup(".");
+	int fd = dir ? open(dir, O_RDONLY | O_DIRECTORY) : -1;
+	if(fd != -1)
+	{
+		fsync(fd);
+		close(fd);
+	}
+	free(dir);
+}
+
+//Save thread, writes the rows to a new file next to the original and renames it over the
+//original once it is on disk, so a failed or interrupted save leaves the original as it was
+void *saveWork(void *arg)
+{
+	struct saveJob *job = arg;
+	job->written = -1;
+	int fd = mkstemp(job->temp);
+	if(fd != -1)
+	{
+		if(fchmod(fd, job->mode) == 0)
+			job->written = saveWriteRows(fd, job->rows, job->numRows);
+		if(job->written != -1 && fsync(fd) == -1)
+			job->written = -1;
+		if(close(fd) == -1)
+			job->written = -1;
+		if(job->written != -1 && rename(job->temp, job->path) == -1)
+			job->written = -1;
+	}
+	job->error = errno;
+	if(job->written == -1)
+		unlink(job->temp);
+	else
+		saveSyncDir(job->path, job->dirLen);
+
+	write(job->pipe[1], "", 1);
+	return NULL;
+}
+
+//Takes the snapshot of the rows and starts the save thread
+//Rows still pointing into the mapping of the old file stay valid, the mapping keeps it alive
+void editorSave()
+{
+	if(Editor.loading)
+	{
+		editorSetStatusMessage("Can't save while the file is still loading");
+		return;
+	}
+	if(Editor.saving)
+	{
+		editorSetStatusMessage("Still saving, try again when it is done");
+		return;
+	}
+
+	if(Editor.filename == NULL)
+	{
+		Editor.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL, 0);
+		if(Editor.filename == NULL)
+		{
+			editorSetStatusMessage("Save aborted");
+			return;
+		}
+		editorSelectSyntax();
+	}
+
+	struct saveJob *job = calloc(1, sizeof(struct saveJob));
+	if(job == NULL)
+		die("calloc");
+	job->path = realpath(Editor.filename, NULL);	//a symbolic link is saved through, not replaced
+	if(job->path == NULL)
+		job->path = strdup(Editor.filename);
+	job->rows = malloc(sizeof(struct iovec) * (Editor.numRows ? Editor.numRows : 1));
+	if(job->path == NULL || job->rows == NULL)
+		die("malloc");
+	const char *slash = strrchr(job->path, '/');
+	job->dirLen = slash ? slash - job->path + 1 : 0;
+	job->temp = malloc(strlen(job->path) + 9);		//".name.XXXXXX" next to it
+	if(job->temp == NULL)
+		die("malloc");
+	sprintf(job->temp, "%.*s.%s.XXXXXX", job->dirLen, job->path, job->path + job->dirLen);
+
+	struct stat st;
+	if(stat(job->path, &st) == 0)
+		job->mode = st.st_mode & 07777;
+	else
+	{
+		mode_t mask = umask(0);		//a new file gets what open() would have given it
+		umask(mask);
+		job->mode = 0666 & ~mask;
+	}
+	job->start = editorNow();
+	job->dirty = Editor.dirty;
+
+	Editor.saveSerial++;
+	int j;
+	for(j = 0; j < Editor.numRows; ++j)
+	{
+		erow *row = editorRowAt(j);
+		job->rows[j] = (struct iovec) {row->chars, row->size};
+		if(row->capacity)
+			row->saveSerial = Editor.saveSerial;
+	}
+	job->numRows = Editor.numRows;
+	swapSaveStarted();
+
+	Editor.saving = job;
+	if(pipe(job->pipe) == -1)
+		die("pipe");
+	job->threaded = pthread_create(&job->thread, NULL, saveWork, job) == 0;
+	if(!job->threaded)
+		saveWork(job);		//the save blocks instead
+	editorWatchFd(job->pipe[0], saveReadable);
+}
+
+//Waits for the running save and reports how it went
+void editorFinishSave()
+{
+	struct saveJob *job = Editor.saving;
+	if(job == NULL)
+		return;
+	if(job->threaded)
+		pthread_join(job->thread, NULL);
+	Editor.saving = NULL;
+	swapSaveFinished(job->written != -1);
+
+	if(job->written != -1)
+	{
+		long long ms = editorNow() - job->start;
+		Editor.dirty -= job->dirty;		//edits made during the save are still unsaved
+		editorSetStatusMessage("%zd bytes written to disk in %lld ms (%.1f MB/s)", job->written, ms,
+				job->written / 1048576.0 / (ms ? ms : 1) * 1000);
+	}
+	else
+		editorSetStatusMessage("Can't save I/0 error: %s", strerror(job->error));
+
+	int j;
+	for(j = 0; j < job->numReleased; ++j)
+		arenaFree(job->released[j].iov_base, job->released[j].iov_len);
+	editorUnwatchFd(job->pipe[0]);
+	close(job->pipe[0]);
+	close(job->pipe[1]);
+	free(job->released);
+	free(job->rows);
+	free(job->temp);
+	free(job->path);
+	free(job);
+}
+
+//Event loop callback for the pipe of the save thread
+void saveReadable(int fd)
+{
+	(void) fd;
+	editorFinishSave();
+}
+
+//Watches the pipe of the current document's save, or with "watch" 0 stops so the save thread
+//runs on in the background while another document is current
+void saveWatch(int watch)
+{
+	struct saveJob *job = Editor.saving;
+	if(job == NULL)
+		return;
+	editorUnwatchFd(job->pipe[0]);
+	if(watch)
+		editorWatchFd(job->pipe[0], saveReadable);
+}
+
+//The row is about to change while the save thread may still read its chars
+//It gives them up to the save, so it gets a copy as if it pointed into the mapping
+void editorThawRow(erow *row)
+{
+	struct saveJob *job = Editor.saving;
+	if(job == NULL || row->saveSerial != Editor.saveSerial || row->capacity == 0)
+		return;
+
+	if(job->numReleased == job->releasedCapacity)
+	{
+		job->releasedCapacity = job->releasedCapacity ? job->releasedCapacity * 2 : 64;
+		job->released = realloc(job->released, sizeof(struct iovec) * job->releasedCapacity);
+		if(job->released == NULL)
+			die("realloc");
+	}
+	job->released[job->numReleased++] = (struct iovec) {row->chars, row->capacity};
+	row->capacity = 0;
+	row->saveSerial = 0;
+}
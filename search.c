@@ -0,0 +1,539 @@
+#include "editor.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//Finds the first "needle" in "haystack", like memmem()
+//With SSE2 16 positions are tested at once on the first and the last byte of the needle
+//and only the ones matching both are compared in full
+const char *searchKernel(const char *haystack, size_t size, const char *needle, size_t len)
+{
+	if(len == 0 || len > size)
+		return NULL;
+	if(len == 1)
+		return memchr(haystack, needle[0], size);
+
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[len - 1]);
+	for(; i + len - 1 + 16 <= size; i += 16)
+	{
+		__m128i blockFirst = _mm_loadu_si128((const __m128i *)(haystack + i));
+		__m128i blockLast = _mm_loadu_si128((const __m128i *)(haystack + i + len - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+					_mm_cmpeq_epi8(blockLast, last)));
+		while(mask)
+		{
+			int bit = __builtin_ctz(mask);
+			if(memcmp(haystack + i + bit + 1, needle + 1, len - 2) == 0)
+				return haystack + i + bit;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	while(i + len <= size)
+	{
+		const char *candidate = memchr(haystack + i, needle[0], size - len + 1 - i);
+		if(!candidate)
+			return NULL;
+		if(memcmp(candidate + 1, needle + 1, len - 1) == 0)
+			return candidate;
+		i = candidate - haystack + 1;
+	}
+	return NULL;
+}
+
+void searchAddMatch(int row, int col, int len)
+{
+	struct editorSearch *search = &Editor.search;
+	if(search->numMatches == search->capacity)
+	{
+		search->capacity = search->capacity ? search->capacity * 2 : 256;
+		search->matches = realloc(search->matches, sizeof(struct searchMatch) * search->capacity);
+		if(search->matches == NULL)
+			die("realloc");
+	}
+	search->matches[search->numMatches++] = (struct searchMatch) {row, col, len};
+}
+
+//Collects every match of "query" in the file, rows are scanned in order so the index comes out sorted
+void searchScan(const char *query, int len)
+{
+	Editor.search.numMatches = 0;
+	if(len == 0)
+		return;
+
+	int i;
+	for(i = 0; i < Editor.numRows; ++i)
+	{
+		erow *row = editorRowAt(i);
+		const char *at = row->chars;
+		const char *end = row->chars + row->size;
+		const char *match;
+		while((match = searchKernel(at, end - at, query, len)))
+		{
+			searchAddMatch(i, match - row->chars, len);
+			at = match + 1;
+		}
+	}
+}
+
+//Every match of a longer query starts where the shorter one matched, only those are checked again
+void searchNarrow(const char *query, int len)
+{
+	struct editorSearch *search = &Editor.search;
+	int kept = 0;
+	int j;
+	for(j = 0; j < search->numMatches; ++j)
+	{
+		struct searchMatch match = search->matches[j];
+		erow *row = editorRowAt(match.row);
+		if(match.col + len <= row->size && memcmp(&row->chars[match.col], query, len) == 0)
+		{
+			match.len = len;
+			search->matches[kept++] = match;
+		}
+	}
+	search->numMatches = kept;
+}
+
+//Brings the match index up to date with "query", narrowing the last one when possible
+void searchUpdate(const char *query, int len)
+{
+	struct editorSearch *search = &Editor.search;
+	int previous = search->query.len;
+
+	if(search->regex)
+		regexFind(query);
+	else if(previous && len >= previous && search->rows == Editor.numRows
+		&& memcmp(query, search->query.buffer, previous) == 0)
+		searchNarrow(query, len);
+	else
+		searchScan(query, len);
+
+	appendBufferReset(&search->query);
+	appendBufferAppend(&search->query, query, len);
+	search->rows = Editor.numRows;
+}
+
+//Index of the first match at or after row, col, wrapping around to the first one
+//Returns -1 when there are no matches
+int searchFirstFrom(int row, int col)
+{
+	struct editorSearch *search = &Editor.search;
+	if(search->numMatches == 0)
+		return -1;
+
+	int low = 0, high = search->numMatches;
+	while(low < high)
+	{
+		int middle = low + (high - low) / 2;
+		struct searchMatch match = search->matches[middle];
+		if(match.row < row || (match.row == row && match.col < col))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low == search->numMatches ? 0 : low;
+}
+
+void searchClear()
+{
+	struct editorSearch *search = &Editor.search;
+	free(search->matches);
+	search->matches = NULL;
+	search->numMatches = 0;
+	search->capacity = 0;
+	search->current = -1;
+	search->active = 0;
+	search->regex = 0;
+	appendBufferReset(&search->query);
+}
+
+//Marks the matches on file row "fileRow" in "marked", a copy of the "len" highlight bytes starting
+//at char "from" (plain when "highLight" is NULL); returns "highLight" when the row has no matches
+unsigned char *searchMarkRow(int fileRow, unsigned char *highLight, unsigned char *marked, int from, int len)
+{
+	struct editorSearch *search = &Editor.search;
+	if(!search->active || search->numMatches == 0 || search->rows != Editor.numRows)
+		return highLight;
+
+	int j = searchFirstFrom(fileRow, 0);
+	if(search->matches[j].row != fileRow)
+		return highLight;
+
+	if(highLight)
+		memcpy(marked, highLight, len);
+	else
+		memset(marked, HL_NORMAL, len);
+	for(; j < search->numMatches && search->matches[j].row == fileRow; ++j)
+	{
+		int start = search->matches[j].col - from;
+		int end = search->matches[j].col + search->matches[j].len - from;
+		if(start < 0)
+			start = 0;
+		if(end > len)
+			end = len;
+		if(start < end)
+			memset(&marked[start], HL_MATCH, end - start);
+	}
+	return marked;
+}
+
+//Called by editorPrompt() after every key
+//A changed query jumps to the first match after where the search started, arrows go to the next
+//and previous matches
+void editorFindCallback(char *query, int key)
+{
+	struct editorSearch *search = &Editor.search;
+
+	if(key == '\x1b' || (key == '\r' && query[0]))	//the prompt is closing
+	{
+		searchClear();
+		return;
+	}
+
+	int len = strlen(query);
+	if(len != search->query.len || memcmp(query, search->query.buffer, len) != 0)
+	{
+		searchUpdate(query, len);
+		search->current = searchFirstFrom(search->originRow, search->originCol);
+	}
+	else
+	{
+		if(search->rows != Editor.numRows)		//rows were loaded meanwhile
+		{
+			searchUpdate(query, len);
+			search->current = searchFirstFrom(Editor.cursorY, Editor.cursorX);
+		}
+		if(search->numMatches && (key == ARROW_RIGHT || key == ARROW_DOWN))
+			search->current = (search->current + 1) % search->numMatches;
+		else if(search->numMatches && (key == ARROW_LEFT || key == ARROW_UP))
+			search->current = (search->current + search->numMatches - 1) % search->numMatches;
+	}
+
+	if(search->current != -1)
+	{
+		Editor.cursorY = search->matches[search->current].row;
+		Editor.cursorX = search->matches[search->current].col;
+		Editor.rowOffset = Editor.numRows;
+	}
+}
+
+//Incremental search, "regex" takes the query as an extended regular expression
+void editorFind(int regex)
+{
+	int savedCursorX = Editor.cursorX;		//save pos, before moving to find
+	int savedCursorY = Editor.cursorY;
+	int savedColumnOff = Editor.columnOffset;
+	int savedRowOff = Editor.rowOffset;
+	int savedWrapOff = Editor.wrapOffset;
+
+	searchClear();
+	Editor.search.active = 1;
+	Editor.search.regex = regex;
+	Editor.search.originRow = Editor.cursorY;
+	Editor.search.originCol = Editor.cursorX;
+
+	char* query = editorPrompt(regex ? "Regex: %s (ESC to cancel)" : "Search: %s (ESC to cancel)",
+				editorFindCallback, 0);
+
+	if(query)
+	{
+		free(query);
+	}
+	else
+	{
+		Editor.cursorX = savedCursorX;
+		Editor.cursorY = savedCursorY;
+		Editor.columnOffset = savedColumnOff;
+		Editor.rowOffset = savedRowOff;
+		Editor.wrapOffset = savedWrapOff;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Regex	***///
+//*************///
+
+//Rows are split in ranges between threads, each with its own compiled copy of the pattern
+//Workers only read rows, the rows are changed afterwards on this thread in row order
+#define MAX_WORKERS 8
+#define WORKER_MIN_ROWS 4096	//fewer rows than this per thread are not worth starting it
+#define MAX_GROUPS 10			//\0 to \9 in a replacement
+
+//Replaced text of row "row", "len" bytes at "at" in the worker's text
+struct regexEdit
+{
+	int row;
+	size_t at;
+	size_t len;
+};
+
+struct regexWorker
+{
+	pthread_t thread;
+	regex_t regex;
+	int from, to;		//rows scanned
+	const char *with;	//replacement, NULL when only collecting matches
+	struct searchMatch *matches;
+	int numMatches;
+	int capacity;
+	char *text;
+	size_t textLen;
+	size_t textCapacity;
+	struct regexEdit *edits;
+	int numEdits;
+	int editCapacity;
+	int replaced;
+};
+
+void regexAddMatch(struct regexWorker *worker, int row, int col, int len)
+{
+	if(worker->numMatches == worker->capacity)
+	{
+		worker->capacity = worker->capacity ? worker->capacity * 2 : 256;
+		worker->matches = realloc(worker->matches, sizeof(struct searchMatch) * worker->capacity);
+		if(worker->matches == NULL)
+			die("realloc");
+	}
+	worker->matches[worker->numMatches++] = (struct searchMatch) {row, col, len};
+}
+
+void regexAddEdit(struct regexWorker *worker, int row, size_t at)
+{
+	if(worker->numEdits == worker->editCapacity)
+	{
+		worker->editCapacity = worker->editCapacity ? worker->editCapacity * 2 : 64;
+		worker->edits = realloc(worker->edits, sizeof(struct regexEdit) * worker->editCapacity);
+		if(worker->edits == NULL)
+			die("realloc");
+	}
+	worker->edits[worker->numEdits++] = (struct regexEdit) {row, at, worker->textLen - at};
+}
+
+//Workers keep their own buffer, appendBufferAppend() counts allocations in a global
+void regexAppend(struct regexWorker *worker, const char *s, size_t len)
+{
+	if(worker->textLen + len > worker->textCapacity)
+	{
+		size_t capacity = worker->textCapacity ? worker->textCapacity : 4096;
+		while(capacity < worker->textLen + len)
+			capacity *= 2;
+		worker->text = realloc(worker->text, capacity);
+		if(worker->text == NULL)
+			die("realloc");
+		worker->textCapacity = capacity;
+	}
+	memcpy(&worker->text[worker->textLen], s, len);
+	worker->textLen += len;
+}
+
+//Appends the replacement for one match, \0 to \9 are the groups of the match and \\ is a backslash
+void regexAppendReplacement(struct regexWorker *worker, const char *chars, regmatch_t *groups)
+{
+	const char *s = worker->with;
+	while(*s)
+	{
+		if(s[0] == '\\' && s[1] >= '0' && s[1] <= '9')
+		{
+			regmatch_t group = groups[s[1] - '0'];
+			if(group.rm_so != -1)
+				regexAppend(worker, &chars[group.rm_so], group.rm_eo - group.rm_so);
+			s += 2;
+		}
+		else if(s[0] == '\\' && s[1])
+		{
+			regexAppend(worker, &s[1], 1);
+			s += 2;
+		}
+		else
+			regexAppend(worker, s++, 1);
+	}
+}
+
+//Thread body, finds every match in rows "from" to "to" and builds the replaced rows when replacing
+//REG_STARTEND lets rows that are slices of the file mapping be matched without a terminating NUL
+void *regexWork(void *arg)
+{
+	struct regexWorker *worker = arg;
+	regmatch_t groups[MAX_GROUPS];
+	int i;
+
+	for(i = worker->from; i < worker->to; ++i)
+	{
+		erow *row = editorRowAt(i);
+		const char *chars = row->chars ? row->chars : "";
+		size_t rowStart = worker->textLen;
+		int copied = 0;		//chars already copied to the replaced row
+		int lastEnd = -1;	//end of the last non-empty match
+		int at = 0;
+		int matched = 0;
+
+		while(at <= row->size)
+		{
+			groups[0].rm_so = at;
+			groups[0].rm_eo = row->size;
+			if(regexec(&worker->regex, chars, MAX_GROUPS, groups, REG_STARTEND) != 0)
+				break;
+
+			int start = groups[0].rm_so;
+			int end = groups[0].rm_eo;
+			if(start == end && start == lastEnd)	//empty match right after a match, like sed
+			{
+				at = start + 1;
+				continue;
+			}
+
+			if(worker->with)
+			{
+				regexAppend(worker, &chars[copied], start - copied);
+				regexAppendReplacement(worker, chars, groups);
+				copied = end;
+				worker->replaced++;
+			}
+			else
+				regexAddMatch(worker, i, start, end - start);
+
+			matched = 1;
+			if(end > start)
+				lastEnd = end;
+			at = end > start ? end : end + 1;
+		}
+
+		if(worker->with && matched)
+		{
+			regexAppend(worker, &chars[copied], row->size - copied);
+			regexAddEdit(worker, i, rowStart);
+		}
+		else
+			worker->textLen = rowStart;
+	}
+	return NULL;
+}
+
+//Runs "pattern" over every row, replacing it with "with" unless it is NULL
+//Returns the number of workers used, 0 when the pattern does not compile
+int regexRun(struct regexWorker *workers, const char *pattern, const char *with)
+{
+	int count = sysconf(_SC_NPROCESSORS_ONLN);
+	if(count > MAX_WORKERS)
+		count = MAX_WORKERS;
+	if(count > Editor.numRows / WORKER_MIN_ROWS)
+		count = Editor.numRows / WORKER_MIN_ROWS;
+	if(count < 1)
+		count = 1;
+
+	int j;
+	for(j = 0; j < count; ++j)
+	{
+		memset(&workers[j], 0, sizeof(struct regexWorker));
+		if(regcomp(&workers[j].regex, pattern, REG_EXTENDED) != 0)
+		{
+			while(j--)
+				regfree(&workers[j].regex);
+			return 0;
+		}
+		workers[j].from = (long long)Editor.numRows * j / count;
+		workers[j].to = (long long)Editor.numRows * (j + 1) / count;
+		workers[j].with = with;
+	}
+
+	for(j = 1; j < count; ++j)
+		if(pthread_create(&workers[j].thread, NULL, regexWork, &workers[j]) != 0)
+			die("pthread_create");
+	regexWork(&workers[0]);
+	for(j = 1; j < count; ++j)
+		pthread_join(workers[j].thread, NULL);
+	return count;
+}
+
+void regexFreeWorkers(struct regexWorker *workers, int count)
+{
+	int j;
+	for(j = 0; j < count; ++j)
+	{
+		regfree(&workers[j].regex);
+		free(workers[j].matches);
+		free(workers[j].text);
+		free(workers[j].edits);
+	}
+}
+
+//Fills the match index with the matches of "pattern", left empty when it does not compile
+void regexFind(const char *pattern)
+{
+	struct editorSearch *search = &Editor.search;
+	struct regexWorker workers[MAX_WORKERS];
+	int count = regexRun(workers, pattern, NULL);
+
+	search->numMatches = 0;
+	int j;
+	for(j = 0; j < count; ++j)
+	{
+		if(search->numMatches + workers[j].numMatches > search->capacity)
+		{
+			while(search->numMatches + workers[j].numMatches > search->capacity)
+				search->capacity = search->capacity ? search->capacity * 2 : 256;
+			search->matches = realloc(search->matches, sizeof(struct searchMatch) * search->capacity);
+			if(search->matches == NULL)
+				die("realloc");
+		}
+		memcpy(&search->matches[search->numMatches], workers[j].matches,
+				sizeof(struct searchMatch) * workers[j].numMatches);
+		search->numMatches += workers[j].numMatches;
+	}
+	regexFreeWorkers(workers, count);
+}
+
+//Replaces every match of a regular expression in the file
+//The new rows are built by the workers and swapped in afterwards in one pass
+void editorReplace()
+{
+	if(Editor.loading)
+	{
+		editorSetStatusMessage("Can't replace while the file is still loading");
+		return;
+	}
+
+	char *pattern = editorPrompt("Replace regex: %s (ESC to cancel)", NULL, 0);
+	if(pattern == NULL)
+		return;
+	char *with = editorPrompt("Replace with: %s (ESC to cancel, \\1 for groups)", NULL, 1);
+	if(with == NULL)
+	{
+		free(pattern);
+		return;
+	}
+
+	struct regexWorker workers[MAX_WORKERS];
+	int count = regexRun(workers, pattern, with);
+	if(count == 0)
+		editorSetStatusMessage("Invalid regex: %s", pattern);
+	else
+	{
+		int replaced = 0, rows = 0;
+		int j, k;
+		for(j = 0; j < count; ++j)
+		{
+			for(k = 0; k < workers[j].numEdits; ++k)
+			{
+				struct regexEdit edit = workers[j].edits[k];
+				editorRowSetString(editorRowAt(edit.row), &workers[j].text[edit.at], edit.len);
+			}
+			replaced += workers[j].replaced;
+			rows += workers[j].numEdits;
+		}
+		if(rows)
+			Editor.dirty++;
+		if(Editor.cursorY < Editor.numRows && Editor.cursorX > editorRowAt(Editor.cursorY)->size)
+			Editor.cursorX = editorRowAt(Editor.cursorY)->size;
+		editorSetStatusMessage("Replaced %d matches on %d lines", replaced, rows);
+		regexFreeWorkers(workers, count);
+	}
+	free(pattern);
+	free(with);
+}
@@ -2,19 +2,31 @@
 
 int main(int argc, char** argv)
 {
+	int streamFd = -1;
+	if(argc >= 2 && strcmp(argv[1], "-") == 0)
+		streamFd = reopenTerminal();
 
 	enableRawMode();
 	initEditor();
-	
-	if(argc >= 2)
-		editorOpen(argv[1]);
 
-	editorSetStatusMessage("HELP: CTRL S = save | CTRL Q = quit | CTRL F = find");
+	int rows, cols;
+	getWindowSize(&rows, &cols);
+	editorResize(rows, cols);
+	editorWatchSignal(SIGWINCH, editorWindowChanged);
+	editorStartHighlighter();
+	editorSetStatusMessage("HELP: CTRL S = save | CTRL Q = quit | CTRL F = find | CTRL R = replace");
+	
+	if(streamFd != -1)
+		editorOpenStream(streamFd);
+	else if(argc >= 2)
+		editorOpen(argv[1]);		//may say that changes were recovered instead
 
 	while(1)
 	{
 		editorRefreshScreen();
-		editorProcessKeyPress();
+		do
+			editorProcessKeyPress();	//everything already typed, then one refresh
+		while(editorKeyPending());
 	}
 
 	return 0;
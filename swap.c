@@ -0,0 +1,376 @@
+#include "editor.h"
+
+#define SWAP_COMMIT_MS 200		//changes gathered into one write and fdatasync()
+#define SWAP_MAGIC "smkswap1"
+
+//Swap file ".name.swp" next to the file, the changes made since it was last saved
+//The UI thread appends records to "pending", the swap thread writes them out in batches so
+//a key press never waits for the disk; a clean exit removes the file, after a crash editorOpen()
+//replays it over the file
+//The swap file is locked with flock() while a document has it, a second editor on the same file
+//leaves it alone
+//Every open document has its own swap file and thread, see buffer.c
+
+//Start of the swap file, the file the changes apply to as it was on disk
+struct swapHeader
+{
+	char magic[8];
+	long long size;
+	long long mtime;
+	long long mtimeNsec;
+	long long inode;
+};
+
+//Followed by "len" bytes of text and "newLen" bytes for UNDO_SET, see undoRecord()
+struct swapRecord
+{
+	int type;
+	int row;
+	int at;
+	int len;
+	int newLen;
+};
+
+//Swap file of one document, Editor.swap
+struct swapFile
+{
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	struct appendBuffer pending;	//not written yet
+	char *reopen;		//swap file to switch to, its header starts pending
+	int reopenFd;		//reopen already opened and locked by swapOpen(), or -1
+	int stopping;
+	pthread_t thread;
+	int running;
+	struct appendBuffer sinceSave;	//changes made since the running save took its snapshot
+	int saving;
+};
+
+//".name.swp" in the directory of "filename"
+char *swapPathFor(const char *filename)
+{
+	const char *slash = strrchr(filename, '/');
+	int dirLen = slash ? slash - filename + 1 : 0;
+	char *path = malloc(strlen(filename) + 6);
+	if(path == NULL)
+		die("malloc");
+	sprintf(path, "%.*s.%s.swp", dirLen, filename, filename + dirLen);
+	return path;
+}
+
+//Opens the swap file at "path" and locks it, -1 with errno EWOULDBLOCK when another editor has it
+int swapLock(const char *path)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+	if(fd != -1 && flock(fd, LOCK_EX | LOCK_NB) == -1)
+	{
+		int saved = errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	return fd;
+}
+
+//Swap thread, writes what was appended every SWAP_COMMIT_MS and makes it durable
+void *swapWork(void *arg)
+{
+	struct swapFile *swap = arg;
+	struct appendBuffer writing = {NULL, 0, 0};
+	char *path = NULL;
+	int fd = -1;
+
+	pthread_mutex_lock(&swap->lock);
+	while(1)
+	{
+		while(swap->pending.len == 0 && swap->reopen == NULL && !swap->stopping)
+			pthread_cond_wait(&swap->wake, &swap->lock);
+		if(swap->pending.len == 0 && swap->reopen == NULL)
+			break;
+		if(swap->reopen == NULL && !swap->stopping)	//let more changes come in
+		{
+			pthread_mutex_unlock(&swap->lock);
+			struct timespec wait = {0, SWAP_COMMIT_MS * 1000000L};
+			nanosleep(&wait, NULL);
+			pthread_mutex_lock(&swap->lock);
+		}
+
+		char *reopen = swap->reopen;
+		int reopenFd = swap->reopenFd;
+		swap->reopen = NULL;
+		swap->reopenFd = -1;
+		struct appendBuffer written = writing;
+		writing = swap->pending;
+		swap->pending = written;
+		pthread_mutex_unlock(&swap->lock);
+
+		if(reopen && fd != -1 && reopenFd == -1 && strcmp(path, reopen) == 0)
+		{
+			free(reopen);		//the same file again, its lock is kept
+			ftruncate(fd, 0);
+		}
+		else if(reopen)
+		{
+			if(fd != -1)
+			{
+				close(fd);
+				if(strcmp(path, reopen) != 0)
+					unlink(path);
+			}
+			free(path);
+			path = reopen;
+			fd = reopenFd != -1 ? reopenFd : swapLock(path);
+			if(fd != -1)
+				ftruncate(fd, 0);
+		}
+		if(fd != -1 && writing.len)
+		{
+			struct iovec iov = {writing.buffer, writing.len};
+			writeAll(fd, &iov, 1);
+			fdatasync(fd);
+		}
+		writing.len = 0;
+		pthread_mutex_lock(&swap->lock);
+	}
+	pthread_mutex_unlock(&swap->lock);
+
+	if(fd != -1)		//stopped on a clean exit, nothing to recover
+	{
+		close(fd);
+		unlink(path);
+	}
+	free(path);
+	appendBufferFree(&writing);
+	return NULL;
+}
+
+//Swap state of the current document, created on first use
+struct swapFile *swapGet()
+{
+	if(Editor.swap == NULL)
+	{
+		Editor.swap = calloc(1, sizeof(struct swapFile));
+		if(Editor.swap == NULL)
+			die("calloc");
+		pthread_mutex_init(&Editor.swap->lock, NULL);
+		pthread_cond_init(&Editor.swap->wake, NULL);
+	}
+	return Editor.swap;
+}
+
+//Starts a new swap file for Editor.filename as it is on disk now, the records in "since" are the
+//changes made to it already; "fd" is the swap file opened and locked already, or -1
+void swapStart(struct appendBuffer *since, int fd)
+{
+	struct stat st;
+	if(Editor.filename == NULL || stat(Editor.filename, &st) == -1)
+	{
+		if(fd != -1)
+			close(fd);
+		return;
+	}
+
+	struct swapFile *swap = swapGet();
+	struct swapHeader header = {SWAP_MAGIC, st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_ino};
+	pthread_mutex_lock(&swap->lock);
+	if(swap->reopen && swap->reopenFd != -1)
+		close(swap->reopenFd);
+	free(swap->reopen);
+	swap->reopen = swapPathFor(Editor.filename);
+	swap->reopenFd = fd;
+	appendBufferReset(&swap->pending);
+	appendBufferAppend(&swap->pending, (char *)&header, sizeof(header));
+	if(since && since->len)
+		appendBufferAppend(&swap->pending, since->buffer, since->len);
+	pthread_cond_signal(&swap->wake);
+	pthread_mutex_unlock(&swap->lock);
+
+	if(!swap->running)
+		swap->running = pthread_create(&swap->thread, NULL, swapWork, swap) == 0;
+}
+
+//Waits for the swap thread and removes the swap file, the document is given up
+void swapStop()
+{
+	struct swapFile *swap = Editor.swap;
+	if(swap == NULL)
+		return;
+	if(swap->running)
+	{
+		pthread_mutex_lock(&swap->lock);
+		swap->stopping = 1;
+		pthread_cond_signal(&swap->wake);
+		pthread_mutex_unlock(&swap->lock);
+		pthread_join(swap->thread, NULL);
+	}
+
+	if(swap->reopen && swap->reopenFd != -1)
+		close(swap->reopenFd);
+	free(swap->reopen);
+	appendBufferFree(&swap->pending);
+	appendBufferFree(&swap->sinceSave);
+	pthread_mutex_destroy(&swap->lock);
+	pthread_cond_destroy(&swap->wake);
+	free(swap);
+	Editor.swap = NULL;
+}
+
+//Called by undoRecord() for every change of the document
+void swapRecord(int type, int row, int at, const char *s, int len, const char *newS, int newLen)
+{
+	struct swapFile *swap = Editor.swap;
+	if(swap == NULL || (!swap->running && !swap->saving))
+		return;
+
+	struct swapRecord record = {type, row, at, len, newLen};
+	if(swap->running)
+	{
+		pthread_mutex_lock(&swap->lock);
+		if(swap->pending.len == 0)
+			pthread_cond_signal(&swap->wake);
+		appendBufferAppend(&swap->pending, (char *)&record, sizeof(record));
+		appendBufferAppend(&swap->pending, s, len);
+		if(newLen)
+			appendBufferAppend(&swap->pending, newS, newLen);
+		pthread_mutex_unlock(&swap->lock);
+	}
+	if(swap->saving)
+	{
+		appendBufferAppend(&swap->sinceSave, (char *)&record, sizeof(record));
+		appendBufferAppend(&swap->sinceSave, s, len);
+		if(newLen)
+			appendBufferAppend(&swap->sinceSave, newS, newLen);
+	}
+}
+
+//A save took its snapshot, the changes from here on are what the new swap file will hold
+void swapSaveStarted()
+{
+	struct swapFile *swap = swapGet();
+	appendBufferReset(&swap->sinceSave);
+	swap->saving = 1;
+}
+
+//The save is done, after a successful one the swap file starts over from the saved file
+void swapSaveFinished(int saved)
+{
+	struct swapFile *swap = swapGet();
+	swap->saving = 0;
+	if(saved)
+		swapStart(&swap->sinceSave, -1);
+	appendBufferFree(&swap->sinceSave);
+}
+
+//The swap file in "data" holds changes to the file "st" is for, as it is on disk now
+int swapMatches(const char *data, size_t size, struct stat *st)
+{
+	struct swapHeader header;
+	if(size < sizeof(header))
+		return 0;
+	memcpy(&header, data, sizeof(header));
+	return memcmp(header.magic, SWAP_MAGIC, sizeof(header.magic)) == 0 && header.size == st->st_size
+		&& header.mtime == st->st_mtim.tv_sec && header.mtimeNsec == st->st_mtim.tv_nsec
+		&& header.inode == (long long)st->st_ino;
+}
+
+//Replays the changes of a swap file left by a crash, the rows have to be loaded and the header
+//has to match, see swapMatches()
+//Returns the number of changes, "used" is set to the bytes up to the end of the last whole record
+int swapReplay(const char *data, size_t size, size_t *used)
+{
+	size_t at = sizeof(struct swapHeader);
+	int count = 0;
+	*used = at;
+	while(at + sizeof(struct swapRecord) <= size)
+	{
+		struct swapRecord record;
+		memcpy(&record, data + at, sizeof(record));
+		at += sizeof(record);
+		if(record.len < 0 || record.newLen < 0 || at + record.len + record.newLen > size)
+			break;		//cut off by the crash
+		const char *text = data + at;
+		at += record.len + record.newLen;
+
+		int rowOk = record.row >= 0 && record.row < Editor.numRows;
+		erow *row = rowOk ? editorRowAt(record.row) : NULL;
+		switch(record.type)
+		{
+			case UNDO_INSERT:
+				if(rowOk && record.at >= 0 && record.at <= row->size)
+					editorRowInsertString(row, record.at, text, record.len);
+				break;
+			case UNDO_DELETE:
+				if(rowOk)
+					editorRowDelString(row, record.at, record.len);
+				break;
+			case UNDO_INSERT_ROW:
+				editorInsertRow(record.row, (char *)text, record.len);
+				break;
+			case UNDO_DELETE_ROW:
+				editorDelRow(record.row);
+				break;
+			case UNDO_SET:
+				if(rowOk && record.at >= 0 && record.at + record.len <= row->size)
+				{
+					editorRowReplaceString(row, record.at, record.len, text + record.len, record.newLen);
+					Editor.dirty++;
+				}
+				break;
+		}
+		count++;
+		*used = at;
+	}
+	return count;
+}
+
+//Starts the swap file of the file just opened, first replaying the one a crash left behind
+//A swap file another editor has locked, or one for another version of the file, is left as it is
+//and the document goes without one
+void swapOpen()
+{
+	char *path = swapPathFor(Editor.filename);
+	int fd = swapLock(path);
+	if(fd == -1 && errno == EWOULDBLOCK)
+	{
+		editorSetStatusMessage("%s is in use by another editor, changes are not swapped", path);
+		free(path);
+		return;
+	}
+
+	struct stat st, swapSt;
+	char *data = NULL;
+	ssize_t size = 0;
+	if(fd != -1 && fstat(fd, &swapSt) == 0 && swapSt.st_size > 0 && stat(Editor.filename, &st) == 0)
+	{
+		data = malloc(swapSt.st_size);
+		size = data ? read(fd, data, swapSt.st_size) : -1;
+		if(size == swapSt.st_size && !swapMatches(data, size, &st))
+		{
+			editorSetStatusMessage("%s is for another version of the file, changes are not swapped", path);
+			close(fd);
+			free(data);
+			free(path);
+			return;
+		}
+	}
+
+	if(data && size == swapSt.st_size)
+	{
+		while(Editor.loading)		//the changes are for the whole file
+			editorLoadStep();
+		undoBegin();
+		size_t used;
+		int count = swapReplay(data, size, &used);		//not recorded, the swap is not started yet
+		if(count > 0)
+			editorSetStatusMessage("Recovered %d changes from %s", count, path);
+
+		//The old records are what the new swap file starts with, so they are only ever replaced
+		//by a file that has them too
+		struct appendBuffer since = {data + sizeof(struct swapHeader), used - sizeof(struct swapHeader), 0};
+		swapStart(&since, fd);
+	}
+	else
+		swapStart(NULL, fd);
+	free(data);
+	free(path);
+}
@@ -0,0 +1,523 @@
+#include "editor.h"
+
+#define HL_SYNC_ROWS 2000		//rows looked at above a drawn row to find the state it starts in
+
+//Byte classes, one table per filetype
+#define CLASS_WORD 1		//letters, '_' and bytes of UTF-8 sequences
+#define CLASS_DIGIT 2
+#define CLASS_QUOTE 4		//starts a string
+#define CLASS_COMMENT 8		//first byte of a comment delimiter
+
+//Line handed to the highlight worker, a copy of the row's chars at generation "generation"
+struct highlightJob
+{
+	int row;
+	unsigned int generation;
+	unsigned int serial;		//jobs are numbered as they are queued
+	struct editorSyntax *syntax;
+	int state;
+	char *text;
+	int len;
+	unsigned char *highLight;	//filled in by the worker
+	struct highlightJob *next;
+};
+
+pthread_mutex_t highlightLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t highlightWake = PTHREAD_COND_INITIALIZER;
+struct highlightJob *highlightTodo;		//oldest first
+struct highlightJob *highlightTodoTail;
+struct highlightJob *highlightDone;
+int highlightPipe[2] = {-1, -1};	//the worker writes a byte when it finished jobs
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//* Filetypes  *///
+//*************///
+
+const char *cExtensions[] = {".c", ".h", ".cpp", ".hpp", ".cc", NULL};
+const char *cKeywords[] = {
+	"switch", "if", "while", "for", "break", "continue", "return", "else", "struct", "union",
+	"typedef", "static", "enum", "class", "case", "default", "do", "goto", "sizeof", "extern",
+	"const", "volatile", "inline", "namespace", "template", "public", "private", "protected",
+	"new", "delete", "#include", "#define", "#ifdef", "#ifndef", "#endif", "#if", "#else",
+
+	"int|", "long|", "double|", "float|", "char|", "unsigned|", "signed|", "void|", "short|",
+	"size_t|", "ssize_t|", "bool|", "auto|", "NULL|", "true|", "false|", NULL
+};
+
+const char *pythonExtensions[] = {".py", NULL};
+const char *pythonKeywords[] = {
+	"and", "as", "assert", "break", "class", "continue", "def", "del", "elif", "else", "except",
+	"finally", "for", "from", "global", "if", "import", "in", "is", "lambda", "nonlocal", "not",
+	"or", "pass", "raise", "return", "try", "while", "with", "yield", "async", "await",
+
+	"None|", "True|", "False|", "self|", "int|", "str|", "float|", "list|", "dict|", "tuple|",
+	"set|", "bytes|", NULL
+};
+
+const char *jsExtensions[] = {".js", ".ts", ".mjs", NULL};
+const char *jsKeywords[] = {
+	"break", "case", "catch", "class", "const", "continue", "default", "delete", "do", "else",
+	"export", "extends", "finally", "for", "function", "if", "import", "in", "instanceof", "let",
+	"new", "return", "switch", "throw", "try", "typeof", "var", "while", "yield", "async", "await",
+
+	"null|", "undefined|", "true|", "false|", "this|", NULL
+};
+
+const char *shellExtensions[] = {".sh", ".bash", "makefile", "Makefile", NULL};
+const char *shellKeywords[] = {
+	"if", "then", "else", "elif", "fi", "for", "while", "until", "do", "done", "case", "esac",
+	"in", "function", "return", "local", "export",
+
+	"echo|", "cd|", "exit|", "set|", "source|", NULL
+};
+
+struct editorSyntax syntaxDatabase[] = {
+	{.filetype = "c", .filematch = cExtensions, .keywords = cKeywords, .singleLineComment = "//",
+		.multiLineStart = "/*", .multiLineEnd = "*/", .quotes = "\"'"},
+	{.filetype = "python", .filematch = pythonExtensions, .keywords = pythonKeywords,
+		.singleLineComment = "#", .quotes = "\"'"},
+	{.filetype = "javascript", .filematch = jsExtensions, .keywords = jsKeywords, .singleLineComment = "//",
+		.multiLineStart = "/*", .multiLineEnd = "*/", .quotes = "\"'`"},
+	{.filetype = "shell", .filematch = shellExtensions, .keywords = shellKeywords,
+		.singleLineComment = "#", .quotes = "\"'"},
+};
+
+unsigned int syntaxHash(const char *s, int len)
+{
+	unsigned int hash = 2166136261u;	//FNV-1a
+	int j;
+	for(j = 0; j < len; ++j)
+		hash = (hash ^ (unsigned char)s[j]) * 16777619u;
+	return hash;
+}
+
+//Builds the byte classes and the keyword hash table of a filetype, once
+void syntaxBuild(struct editorSyntax *syntax)
+{
+	if(syntax->table)
+		return;
+
+	int j;
+	for(j = 0; j < 256; ++j)
+	{
+		if(isalpha(j) || j == '_' || j >= 128)
+			syntax->classes[j] |= CLASS_WORD;
+		if(isdigit(j))
+			syntax->classes[j] |= CLASS_DIGIT;
+	}
+	for(j = 0; syntax->quotes[j]; ++j)
+		syntax->classes[(unsigned char)syntax->quotes[j]] |= CLASS_QUOTE;
+	if(syntax->singleLineComment)
+	{
+		syntax->singleLineLen = strlen(syntax->singleLineComment);
+		syntax->classes[(unsigned char)syntax->singleLineComment[0]] |= CLASS_COMMENT;
+	}
+	if(syntax->multiLineStart)
+	{
+		syntax->multiLineStartLen = strlen(syntax->multiLineStart);
+		syntax->multiLineEndLen = strlen(syntax->multiLineEnd);
+		syntax->classes[(unsigned char)syntax->multiLineStart[0]] |= CLASS_COMMENT;
+	}
+
+	int count = 0;
+	while(syntax->keywords[count])
+		count++;
+	unsigned int size = 16;
+	while(size < (unsigned int)count * 2)
+		size *= 2;
+	syntax->table = calloc(size, sizeof(struct syntaxKeyword));
+	if(syntax->table == NULL)
+		die("calloc");
+	syntax->tableMask = size - 1;
+
+	for(j = 0; j < count; ++j)
+	{
+		const char *word = syntax->keywords[j];
+		int len = strlen(word);
+		int type = HL_KEYWORD1;
+		if(word[len - 1] == '|')
+		{
+			len--;
+			type = HL_KEYWORD2;
+		}
+		if(word[0] == '#')		//preprocessor words start with a byte that is not a word byte
+			syntax->classes['#'] |= CLASS_WORD;
+		if(len > syntax->maxKeywordLen)
+			syntax->maxKeywordLen = len;
+
+		unsigned int at = syntaxHash(word, len) & syntax->tableMask;
+		while(syntax->table[at].word)
+			at = (at + 1) & syntax->tableMask;
+		syntax->table[at] = (struct syntaxKeyword) {word, len, type};
+	}
+}
+
+//Returns HL_KEYWORD1 or HL_KEYWORD2 for a keyword, HL_NORMAL otherwise
+int syntaxKeyword(struct editorSyntax *syntax, const char *s, int len)
+{
+	if(len > syntax->maxKeywordLen)
+		return HL_NORMAL;
+
+	unsigned int at = syntaxHash(s, len) & syntax->tableMask;
+	while(syntax->table[at].word)
+	{
+		struct syntaxKeyword *keyword = &syntax->table[at];
+		if(keyword->len == len && memcmp(keyword->word, s, len) == 0)
+			return keyword->type;
+		at = (at + 1) & syntax->tableMask;
+	}
+	return HL_NORMAL;
+}
+
+//Picks the filetype from Editor.filename, every row is highlighted again when it changes
+void editorSelectSyntax()
+{
+	struct editorSyntax *syntax = NULL;
+
+	if(Editor.filename)
+	{
+		const char *name = strrchr(Editor.filename, '/');
+		name = name ? name + 1 : Editor.filename;
+		const char *extension = strrchr(name, '.');
+
+		unsigned int j;
+		for(j = 0; j < sizeof(syntaxDatabase) / sizeof(syntaxDatabase[0]) && !syntax; ++j)
+		{
+			const char **match;
+			for(match = syntaxDatabase[j].filematch; *match; ++match)
+				if(strcmp(*match, (*match)[0] == '.' ? (extension ? extension : "") : name) == 0)
+				{
+					syntax = &syntaxDatabase[j];
+					break;
+				}
+		}
+	}
+
+	if(syntax == Editor.syntax)
+		return;
+	if(syntax)
+		syntaxBuild(syntax);
+	Editor.syntax = syntax;
+
+	int i;
+	for(i = 0; i < Editor.numRows; ++i)
+	{
+		erow *row = editorRowAt(i);
+		row->stateKnown = 0;
+		row->highlighted = 0;
+		row->hlGeneration = ++Editor.highLightGeneration;
+	}
+	editorHighlightChanged(0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//* Highlight  *///
+//*************///
+
+//Highlights the "len" bytes of a line starting in "state" into "hl", returns the state at the end
+//of the line; with a NULL "hl" only the state is worked out
+//It only reads "syntax" and the line, so the highlight worker runs it too
+int editorSyntaxLine(struct editorSyntax *syntax, const char *s, int len, unsigned char *hl, int state)
+{
+	if(syntax == NULL)
+		return HL_STATE_NORMAL;
+
+	const unsigned char *classes = syntax->classes;
+	int separator = 1;		//the previous byte ends a word
+	int i = 0;
+	while(i < len)
+	{
+		if(state == HL_STATE_COMMENT)
+		{
+			const char *end = searchKernel(&s[i], len - i, syntax->multiLineEnd, syntax->multiLineEndLen);
+			int stop = end ? end - s + syntax->multiLineEndLen : len;
+			if(hl)
+				memset(&hl[i], HL_COMMENT, stop - i);
+			if(end)
+				state = HL_STATE_NORMAL;
+			i = stop;
+			separator = 1;
+			continue;
+		}
+
+		unsigned char c = s[i];
+		int class = classes[c];
+		int end = i + 1;
+		int type = HL_NORMAL;
+
+		if(class & CLASS_COMMENT)
+		{
+			if(syntax->singleLineLen && i + syntax->singleLineLen <= len
+				&& memcmp(&s[i], syntax->singleLineComment, syntax->singleLineLen) == 0)
+			{
+				if(hl)
+					memset(&hl[i], HL_COMMENT, len - i);
+				break;
+			}
+			if(syntax->multiLineStartLen && i + syntax->multiLineStartLen <= len
+				&& memcmp(&s[i], syntax->multiLineStart, syntax->multiLineStartLen) == 0)
+			{
+				if(hl)
+					memset(&hl[i], HL_COMMENT, syntax->multiLineStartLen);
+				state = HL_STATE_COMMENT;
+				i += syntax->multiLineStartLen;
+				continue;
+			}
+		}
+
+		if(class & CLASS_QUOTE)
+		{
+			while(end < len && s[end] != c)
+				end += s[end] == '\\' && end + 1 < len ? 2 : 1;
+			if(end < len)
+				end++;
+			type = HL_STRING;
+		}
+		else if((class & CLASS_DIGIT) && separator)
+		{
+			while(end < len && ((classes[(unsigned char)s[end]] & (CLASS_WORD | CLASS_DIGIT)) || s[end] == '.'))
+				end++;
+			type = HL_NUMBER;
+		}
+		else if((class & CLASS_WORD) && separator)
+		{
+			while(end < len && (classes[(unsigned char)s[end]] & (CLASS_WORD | CLASS_DIGIT)))
+				end++;
+			if(hl)
+				type = syntaxKeyword(syntax, &s[i], end - i);
+		}
+
+		if(hl && type != HL_NORMAL)
+			memset(&hl[i], type, end - i);
+		separator = type == HL_STRING || !(class & (CLASS_WORD | CLASS_DIGIT));
+		i = end;
+	}
+	return state;
+}
+
+//Colors the row on this thread, hlStateIn has to be set
+//Rows of files without a filetype have no highLight at all
+void editorUpdateSyntax(erow *row)
+{
+	row->highlighted = 1;
+	if(Editor.syntax == NULL || row->size == 0)
+	{
+		arenaFree(row->highLight, row->hlSize);
+		row->highLight = NULL;
+		row->hlSize = 0;
+		return;
+	}
+
+	row->highLight = arenaResize(row->highLight, row->hlSize, row->size);
+	row->hlSize = row->size;
+	memset(row->highLight, HL_NORMAL, row->size);
+	editorSyntaxLine(Editor.syntax, row->chars, row->size, row->highLight, row->hlStateIn);
+}
+
+//Colors the row, on the highlight worker when it runs
+//Until the result is back the row keeps the colors it had, new chars are plain
+void editorHighlightRow(erow *row, int at)
+{
+	if(highlightPipe[0] == -1 || Editor.highLightNow || Editor.syntax == NULL || row->size == 0)
+	{
+		editorUpdateSyntax(row);
+		return;
+	}
+	if(row->hlQueued == row->hlGeneration && row->hlJob > Editor.highLightDropped)
+		return;		//already on its way
+
+	if(row->hlSize < row->size)
+	{
+		row->highLight = arenaResize(row->highLight, row->hlSize, row->size);
+		memset(&row->highLight[row->hlSize], HL_NORMAL, row->size - row->hlSize);
+		row->hlSize = row->size;
+	}
+
+	struct highlightJob *job = malloc(sizeof(struct highlightJob));
+	char *text = malloc(row->size);
+	if(job == NULL || text == NULL)
+		die("malloc");
+	memcpy(text, row->chars, row->size);
+	*job = (struct highlightJob) {at, row->hlGeneration, ++Editor.highLightJobs, Editor.syntax, row->hlStateIn,
+				text, row->size, NULL, NULL};
+	row->hlQueued = row->hlGeneration;
+	row->hlJob = job->serial;
+
+	pthread_mutex_lock(&highlightLock);
+	if(highlightTodoTail)
+		highlightTodoTail->next = job;
+	else
+		highlightTodo = job;
+	highlightTodoTail = job;
+	pthread_cond_signal(&highlightWake);
+	pthread_mutex_unlock(&highlightLock);
+}
+
+//Makes sure rows "first" to "last" are highlighted for the state the rows above them end in
+//End states are always worked out here, only the colors may come later from the worker
+//Rows above Editor.highLightFrom are known to be right, so only the ones from there on are
+//looked at; a row is highlighted again only when it changed or the state it starts in did,
+//which stops an edit from invalidating the rows below once the state is back to what it was
+//Far below that row the walk starts at most HL_SYNC_ROWS above "first" instead, from a state
+//assumed at Editor.highLightSync
+void editorHighlightRows(int first, int last)
+{
+	int from = Editor.highLightFrom;
+	int exact = 1;		//the walk starts from a row known to be right
+	if(from > first)
+		from = first;
+	if(first - from > HL_SYNC_ROWS)
+	{
+		exact = 0;
+		if(first > Editor.highLightSync && first - Editor.highLightSyncEnd <= HL_SYNC_ROWS)
+			from = first < Editor.highLightSyncEnd ? first : Editor.highLightSyncEnd;
+		else
+			from = Editor.highLightSync = Editor.highLightSyncEnd = first - HL_SYNC_ROWS;
+	}
+
+	int state = from > 0 ? editorRowAt(from - 1)->hlState : HL_STATE_NORMAL;
+	int i;
+	for(i = from; i <= last; ++i)
+	{
+		erow *row = editorRowAt(i);
+		if(!row->stateKnown || row->hlStateIn != state)
+		{
+			if(row->hlStateIn != state)
+			{
+				row->hlStateIn = state;
+				row->highlighted = 0;
+				row->hlGeneration = ++Editor.highLightGeneration;
+			}
+			row->hlState = editorSyntaxLine(Editor.syntax, row->chars, row->size, NULL, state);
+			row->stateKnown = 1;
+		}
+		if(i >= first && !row->highlighted)
+			editorHighlightRow(row, i);
+		state = row->hlState;
+		if(exact && i + 1 > Editor.highLightFrom)
+			Editor.highLightFrom = i + 1;
+	}
+	if(!exact && last + 1 > Editor.highLightSyncEnd)
+		Editor.highLightSyncEnd = last + 1;
+}
+
+//Row "at" changed, was added or was removed, the rows from there on have to be checked again
+void editorHighlightChanged(int at)
+{
+	if(at < Editor.highLightFrom)
+		Editor.highLightFrom = at;
+	if(at < Editor.highLightSyncEnd)
+		Editor.highLightSyncEnd = at > Editor.highLightSync ? at : Editor.highLightSync;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Worker ***///
+//*************///
+
+//Highlight thread, colors the jobs queued by editorHighlightRow() one after another
+void *highlightWork(void *arg)
+{
+	(void)arg;
+	pthread_mutex_lock(&highlightLock);
+	while(1)
+	{
+		while(highlightTodo == NULL)
+			pthread_cond_wait(&highlightWake, &highlightLock);
+		struct highlightJob *job = highlightTodo;
+		highlightTodo = job->next;
+		if(highlightTodo == NULL)
+			highlightTodoTail = NULL;
+		pthread_mutex_unlock(&highlightLock);
+
+		job->highLight = malloc(job->len + 1);
+		if(job->highLight)
+		{
+			memset(job->highLight, HL_NORMAL, job->len);
+			editorSyntaxLine(job->syntax, job->text, job->len, job->highLight, job->state);
+		}
+
+		pthread_mutex_lock(&highlightLock);
+		int wake = highlightDone == NULL;
+		job->next = highlightDone;
+		highlightDone = job;
+		if(wake)
+			write(highlightPipe[1], "", 1);
+	}
+	return NULL;
+}
+
+//Event loop callback for the worker's pipe, results for rows that changed since are dropped
+//A row that only moved is not found either, so rows queued before a dropped job are queued again
+void highlightReadable(int fd)
+{
+	char buf[64];
+	while(read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	pthread_mutex_lock(&highlightLock);
+	struct highlightJob *job = highlightDone;
+	highlightDone = NULL;
+	pthread_mutex_unlock(&highlightLock);
+
+	while(job)
+	{
+		struct highlightJob *next = job->next;
+		erow *row = job->row < Editor.numRows ? editorRowAt(job->row) : NULL;
+		if(row && job->highLight && row->hlGeneration == job->generation)
+		{
+			row->highLight = arenaResize(row->highLight, row->hlSize, job->len);
+			memcpy(row->highLight, job->highLight, job->len);
+			row->hlSize = job->len;
+			row->highlighted = 1;
+		}
+		else if(job->serial > Editor.highLightDropped)
+			Editor.highLightDropped = job->serial;
+		free(job->highLight);
+		free(job->text);
+		free(job);
+		job = next;
+	}
+}
+
+//Moves coloring rows off the UI thread, without it rows are colored as they are drawn
+void editorStartHighlighter()
+{
+	pthread_t thread;
+	if(pipe(highlightPipe) == -1)
+		die("pipe");
+	fcntl(highlightPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(highlightPipe[1], F_SETFL, O_NONBLOCK);
+	if(pthread_create(&thread, NULL, highlightWork, NULL) != 0)
+	{
+		close(highlightPipe[0]);
+		close(highlightPipe[1]);
+		highlightPipe[0] = highlightPipe[1] = -1;
+		return;
+	}
+	pthread_detach(thread);
+	editorWatchFd(highlightPipe[0], highlightReadable);
+}
+
+int editorSyntaxToColor(int highLight)
+{
+	switch(highLight)
+	{
+		case HL_COMMENT:
+			return 36;		//cyan
+		case HL_KEYWORD1:
+			return 33;		//yellow
+		case HL_KEYWORD2:
+			return 32;		//green
+		case HL_STRING:
+			return 35;		//magenta
+		case HL_NUMBER:
+			return 31;		//red
+		case HL_MATCH:
+			return 34;		//blue
+		default:
+			return 37;		//default white
+	}
+}
@@ -0,0 +1,220 @@
+#include "editor.h"
+
+#define UNDO_RUN 256		//longest typing run merged into one operation
+
+//Operation journal, recorded by the row functions that change the document
+//Every key press starts a group and CTRL Z undoes the newest group as a whole; a run of typing or
+//deleting on one row is merged into a single operation and a single group
+//The journal keeps the text an operation added or removed, never the rest of the row, so undoing a
+//replace over the whole file costs what the replace changed
+//Operations from "first" up to "numOps" can be undone, the ones up to "totalOps" redone
+//Every change also goes to the swap file, see swap.c
+
+//Starts the group of the next changes, the cursor is put back here when it is undone
+void undoBegin()
+{
+	struct editorUndo *undo = &Editor.undo;
+	undo->group++;
+	undo->cursorX = Editor.cursorX;
+	undo->cursorY = Editor.cursorY;
+}
+
+void undoClear()
+{
+	struct editorUndo *undo = &Editor.undo;
+	free(undo->ops);
+	appendBufferFree(&undo->text);
+	undo->ops = NULL;
+	undo->capacity = 0;
+	undo->first = undo->numOps = undo->totalOps = 0;
+	undo->textFirst = 0;
+}
+
+//Bytes the journal takes
+size_t undoSize()
+{
+	struct editorUndo *undo = &Editor.undo;
+	return (size_t)(undo->text.len - undo->textFirst) + sizeof(struct undoOp) * (undo->totalOps - undo->first);
+}
+
+//Drops the oldest groups until the journal is under Editor.undo.limit
+//When the group being recorded does not fit by itself, the journal is emptied and the rest of
+//that group is not recorded
+void undoTrim()
+{
+	struct editorUndo *undo = &Editor.undo;
+	while(undoSize() > undo->limit && undo->first < undo->numOps)
+	{
+		unsigned int group = undo->ops[undo->first].group;
+		if(group == undo->group)
+		{
+			undo->dropGroup = group;
+			undoClear();
+			return;
+		}
+		while(undo->first < undo->numOps && undo->ops[undo->first].group == group)
+			undo->first++;
+		undo->textFirst = undo->first < undo->totalOps ? undo->ops[undo->first].text : undo->text.len;
+	}
+
+	if(undo->first > undo->totalOps / 2 && undo->first > 64)	//compact, amortized over the dropped ops
+	{
+		int j;
+		int count = undo->totalOps - undo->first;
+		memmove(undo->ops, &undo->ops[undo->first], sizeof(struct undoOp) * count);
+		for(j = 0; j < count; ++j)
+			undo->ops[j].text -= undo->textFirst;
+		memmove(undo->text.buffer, &undo->text.buffer[undo->textFirst], undo->text.len - undo->textFirst);
+		undo->text.len -= undo->textFirst;
+		undo->numOps -= undo->first;
+		undo->totalOps -= undo->first;
+		undo->first = 0;
+		undo->textFirst = 0;
+	}
+}
+
+//Merges the change into the newest operation when it continues it, returns 0 when it does not
+int undoMerge(int type, int row, int at, const char *s, int len)
+{
+	struct editorUndo *undo = &Editor.undo;
+	if(undo->numOps == undo->first || (type != UNDO_INSERT && type != UNDO_DELETE))
+		return 0;
+
+	struct undoOp *last = &undo->ops[undo->numOps - 1];
+	if(last->type != type || last->row != row || last->len + len > UNDO_RUN
+		|| (last->group != undo->group && last->group != undo->group - 1))
+		return 0;
+	if(undo->numOps - 1 > undo->first && undo->ops[undo->numOps - 2].group == last->group)
+		return 0;		//only a group of a single operation grows
+	if(memchr(s, ' ', len) && !memchr(&undo->text.buffer[last->text], ' ', last->len))
+		return 0;		//typing breaks into words
+
+	if(type == UNDO_INSERT && at == last->at + last->len)
+		appendBufferAppend(&undo->text, s, len);
+	else if(type == UNDO_DELETE && at == last->at)		//DEL key
+		appendBufferAppend(&undo->text, s, len);
+	else if(type == UNDO_DELETE && at + len == last->at)		//backspace
+	{
+		appendBufferAppend(&undo->text, s, len);
+		char *text = &undo->text.buffer[last->text];
+		memmove(text + len, text, last->len);
+		memcpy(text, s, len);
+		last->at = at;
+	}
+	else
+		return 0;
+
+	last->len += len;
+	last->group = undo->group;
+	return 1;
+}
+
+//Records a change of the document, "s" is the text added or removed, for UNDO_SET the old text of
+//the span at "at" and "newS" what replaced it
+void undoRecord(int type, int row, int at, const char *s, int len, const char *newS, int newLen)
+{
+	struct editorUndo *undo = &Editor.undo;
+	if(Editor.loadingRow)
+		return;
+	swapRecord(type, row, at, s, len, newS, newLen);
+	if(undo->paused || undo->dropGroup == undo->group || undo->limit == 0)
+		return;
+
+	if(undo->totalOps > undo->numOps)	//a new change drops what was undone
+	{
+		undo->totalOps = undo->numOps;
+		undo->text.len = undo->numOps > undo->first ? undo->ops[undo->numOps - 1].text +
+				undo->ops[undo->numOps - 1].len + undo->ops[undo->numOps - 1].newLen : undo->textFirst;
+	}
+	if(undoMerge(type, row, at, s, len))
+		return;
+
+	if(undo->totalOps == undo->capacity)
+	{
+		undo->capacity = undo->capacity ? undo->capacity * 2 : 256;
+		undo->ops = realloc(undo->ops, sizeof(struct undoOp) * undo->capacity);
+		if(undo->ops == NULL)
+			die("realloc");
+	}
+	undo->ops[undo->totalOps++] = (struct undoOp) {type, row, at, len, newLen, undo->cursorX, undo->cursorY,
+				undo->group, undo->text.len};
+	undo->numOps = undo->totalOps;
+	appendBufferAppend(&undo->text, s, len);
+	if(newLen)
+		appendBufferAppend(&undo->text, newS, newLen);
+	undoTrim();
+}
+
+//Applies the operation backwards, or forwards again with "redo"
+void undoApply(struct undoOp *op, int redo)
+{
+	const char *text = &Editor.undo.text.buffer[op->text];
+	int insert = (op->type == UNDO_INSERT || op->type == UNDO_INSERT_ROW) == redo;
+	switch(op->type)
+	{
+		case UNDO_INSERT:
+		case UNDO_DELETE:
+			if(insert)
+				editorRowInsertString(editorRowAt(op->row), op->at, text, op->len);
+			else
+				editorRowDelString(editorRowAt(op->row), op->at, op->len);
+			Editor.cursorY = op->row;
+			Editor.cursorX = op->at + (insert ? op->len : 0);
+			break;
+		case UNDO_INSERT_ROW:
+		case UNDO_DELETE_ROW:
+			if(insert)
+				editorInsertRow(op->row, (char *)text, op->len);
+			else
+				editorDelRow(op->row);
+			Editor.cursorY = op->row;
+			Editor.cursorX = 0;
+			break;
+		case UNDO_SET:
+			editorRowReplaceString(editorRowAt(op->row), op->at, redo ? op->len : op->newLen,
+					redo ? text + op->len : text, redo ? op->newLen : op->len);
+			Editor.dirty++;
+			Editor.cursorY = op->row;
+			Editor.cursorX = 0;
+			break;
+	}
+}
+
+//Undoes the newest group of changes
+void editorUndo()
+{
+	struct editorUndo *undo = &Editor.undo;
+	if(undo->numOps == undo->first)
+	{
+		editorSetStatusMessage("Nothing to undo");
+		return;
+	}
+
+	undo->paused++;
+	unsigned int group = undo->ops[undo->numOps - 1].group;
+	while(undo->numOps > undo->first && undo->ops[undo->numOps - 1].group == group)
+		undoApply(&undo->ops[--undo->numOps], 0);
+	undo->paused--;
+
+	Editor.cursorX = undo->ops[undo->numOps].cursorX;
+	Editor.cursorY = undo->ops[undo->numOps].cursorY;
+	undo->group++;		//the next change does not merge into the group before
+}
+
+//Does the last undone group of changes again
+void editorRedo()
+{
+	struct editorUndo *undo = &Editor.undo;
+	if(undo->numOps == undo->totalOps)
+	{
+		editorSetStatusMessage("Nothing to redo");
+		return;
+	}
+
+	undo->paused++;
+	unsigned int group = undo->ops[undo->numOps].group;
+	while(undo->numOps < undo->totalOps && undo->ops[undo->numOps].group == group)
+		undoApply(&undo->ops[undo->numOps++], 1);
+	undo->paused--;
+	undo->group++;
+}
@@ -0,0 +1,423 @@
+#include "editor.h"
+
+#define VIEW_MIN_ROWS 2		//text rows a split leaves to each half
+#define VIEW_MIN_COLUMNS 16
+
+//Views on the screen, each shows a document of the buffer list with a cursor and offsets of its own
+//The screen is a tree of splits, stacked or side by side, with a view in every leaf
+//Editor has the cursor, offsets and size of the focused view, the other views keep theirs here and
+//get them back into Editor while they are drawn
+//Views draw into lines of their own and the frame is composed from them; a view of a document
+//without the focus is only drawn again when it was damaged, so typing in one view does not redraw
+//views of other documents. Views of one document share its rows and highlight
+
+//Node of the split tree
+struct viewNode
+{
+	int view;		//-1 for a split
+	int vertical;	//the two halves side by side
+	struct viewNode *first;
+	struct viewNode *second;
+	struct viewNode *parent;
+};
+
+struct editorView
+{
+	int buffer;		//index in the buffer list of the document shown
+	int cursorX, cursorY;
+	int rowOffset;
+	int columnOffset;
+	int wrapOffset;
+	int top, left;	//of the text area, the status bar is the line below it
+	int rows, columns;
+	struct viewNode *node;
+	struct appendBuffer *lines;	//text rows and status bar as last drawn
+	int *widths;	//columns each of them takes
+	int numLines;
+	int valid;		//lines are up to date
+};
+
+struct editorView *views;
+int numViews;
+int viewsCapacity;
+int focusView;
+struct viewNode *viewRoot;
+int drawnBuffer = -1;	//document of the focused view in the last frame
+int drawnFocus = -1;
+
+struct viewNode *viewNewNode(int view, struct viewNode *parent)
+{
+	struct viewNode *node = calloc(1, sizeof(struct viewNode));
+	if(node == NULL)
+		die("calloc");
+	node->view = view;
+	node->parent = parent;
+	return node;
+}
+
+//Adds a view of "buffer" and returns its index
+int viewNew(int buffer)
+{
+	if(numViews == viewsCapacity)
+	{
+		viewsCapacity = viewsCapacity ? viewsCapacity * 2 : 8;
+		views = realloc(views, sizeof(struct editorView) * viewsCapacity);
+		if(views == NULL)
+			die("realloc");
+	}
+	memset(&views[numViews], 0, sizeof(struct editorView));
+	views[numViews].buffer = buffer;
+	return numViews++;
+}
+
+//Gives the view the rectangle, "rows" counts its status bar
+void viewPlace(struct editorView *view, int top, int left, int rows, int columns)
+{
+	int j;
+	view->top = top;
+	view->left = left;
+	view->rows = rows - 1;
+	view->columns = columns;
+	view->valid = 0;
+	if(view->numLines != rows)
+	{
+		for(j = 0; j < view->numLines; ++j)
+			appendBufferFree(&view->lines[j]);
+		view->lines = realloc(view->lines, sizeof(struct appendBuffer) * rows);
+		view->widths = realloc(view->widths, sizeof(int) * rows);
+		if(view->lines == NULL || view->widths == NULL)
+			die("realloc");
+		for(j = 0; j < rows; ++j)
+			view->lines[j] = (struct appendBuffer) {NULL, 0, 0};
+		view->numLines = rows;
+	}
+}
+
+//Splits the rectangle between the views under "node", halves go to the first one
+void viewLayoutNode(struct viewNode *node, int top, int left, int rows, int columns)
+{
+	if(node->view != -1)
+	{
+		viewPlace(&views[node->view], top, left, rows, columns);
+		return;
+	}
+	if(node->vertical)
+	{
+		int first = (columns - 1) / 2;		//and a column for the separator
+		viewLayoutNode(node->first, top, left, rows, first);
+		viewLayoutNode(node->second, top, left + first + 1, rows, columns - first - 1);
+	}
+	else
+	{
+		viewLayoutNode(node->first, top, left, rows / 2, columns);
+		viewLayoutNode(node->second, top + rows / 2, left, rows - rows / 2, columns);
+	}
+}
+
+//Lays the views out over the terminal, the last line is left to the message bar
+void viewLayout()
+{
+	if(viewRoot == NULL)
+	{
+		viewRoot = viewNewNode(viewNew(bufferIndex()), NULL);
+		views[0].node = viewRoot;
+	}
+	viewLayoutNode(viewRoot, 0, 0, Editor.terminalRows - 1, Editor.terminalColumns);
+
+	struct editorView *view = &views[focusView];
+	Editor.screenTop = view->top;
+	Editor.screenLeft = view->left;
+	Editor.screenRows = view->rows;
+	Editor.screenColumns = view->columns;
+}
+
+//Keeps what Editor has for the focused view
+void viewSave()
+{
+	struct editorView *view = &views[focusView];
+	view->buffer = bufferIndex();
+	view->cursorX = Editor.cursorX;
+	view->cursorY = Editor.cursorY;
+	view->rowOffset = Editor.rowOffset;
+	view->columnOffset = Editor.columnOffset;
+	view->wrapOffset = Editor.wrapOffset;
+}
+
+//Shows the document of view "at" with its cursor, offsets and size
+void viewEnter(int at)
+{
+	struct editorView *view = &views[at];
+	bufferSwitch(view->buffer);
+	Editor.cursorX = view->cursorX;
+	Editor.cursorY = view->cursorY;
+	Editor.rowOffset = view->rowOffset;
+	Editor.columnOffset = view->columnOffset;
+	Editor.wrapOffset = view->wrapOffset;
+	Editor.screenTop = view->top;
+	Editor.screenLeft = view->left;
+	Editor.screenRows = view->rows;
+	Editor.screenColumns = view->columns;
+
+	if(Editor.cursorY > Editor.numRows)		//rows were deleted through another view
+		Editor.cursorY = Editor.numRows;
+	int rowLen = Editor.cursorY < Editor.numRows ? editorRowAt(Editor.cursorY)->size : 0;
+	if(Editor.cursorX > rowLen)
+		Editor.cursorX = rowLen;
+}
+
+//Keeps the cursor and offsets of view "at" after it was drawn
+void viewLeave(int at)
+{
+	struct editorView *view = &views[at];
+	view->cursorX = Editor.cursorX;
+	view->cursorY = Editor.cursorY;
+	view->rowOffset = Editor.rowOffset;
+	view->columnOffset = Editor.columnOffset;
+	view->wrapOffset = Editor.wrapOffset;
+}
+
+//Draws the text rows and status bar of the view shown in Editor
+void viewDrawLines(struct editorView *view)
+{
+	if(!Editor.viewer)
+		editorHighlightRows(Editor.rowOffset, Editor.rowOffset + Editor.screenRows - 1 < Editor.numRows
+					? Editor.rowOffset + Editor.screenRows - 1 : Editor.numRows - 1);
+	int y;
+	for(y = 0; y < view->rows; ++y)
+	{
+		appendBufferReset(&view->lines[y]);
+		view->widths[y] = editorDrawRow(&view->lines[y], y);
+	}
+	appendBufferReset(&view->lines[y]);
+	editorDrawStatusBar(&view->lines[y]);
+	view->widths[y] = view->columns;
+}
+
+//Draws the views that were damaged, and every view of the focused document as any of them may
+//show what changed; the others keep their lines
+//Editor.rowOffset has to be scrolled to the cursor already
+void viewDraw()
+{
+	int current = bufferIndex();
+	int shadowOffset = Editor.shadowOffset;
+	int j;
+	viewSave();
+	if(drawnBuffer != current || drawnFocus != focusView)
+	{
+		for(j = 0; j < numViews; ++j)		//their document may have changed since they were drawn
+			if(views[j].buffer == drawnBuffer || j == drawnFocus)
+				views[j].valid = 0;
+	}
+
+	int rowX = Editor.rowX;
+	int searching = Editor.search.active;
+	for(j = 0; j < numViews; ++j)
+	{
+		if(views[j].valid && views[j].buffer != current)
+			continue;
+		viewEnter(j);
+		if(j != focusView)
+			editorScroll();
+		Editor.highLightNow = views[j].buffer != current;	//the worker's results would be dropped
+		Editor.search.active = searching && views[j].buffer == current;
+		viewDrawLines(&views[j]);
+		viewLeave(j);
+		views[j].valid = 1;
+	}
+	Editor.highLightNow = 0;
+	Editor.search.active = searching;
+	viewEnter(focusView);
+	Editor.rowX = rowX;
+	Editor.shadowOffset = shadowOffset;
+	drawnBuffer = current;
+	drawnFocus = focusView;
+}
+
+//View that has column "x" of screen line "y", NULL over the separators
+struct editorView *viewAt(int y, int x)
+{
+	int j;
+	for(j = 0; j < numViews; ++j)
+	{
+		struct editorView *view = &views[j];
+		if(y >= view->top && y <= view->top + view->rows && x >= view->left && x < view->left + view->columns)
+			return view;
+	}
+	return NULL;
+}
+
+//Composes line "y" of the screen from the lines of the views on it, left to right
+void viewComposeLine(struct appendBuffer *ab, int y)
+{
+	int x = 0;
+	while(x < Editor.terminalColumns)
+	{
+		struct editorView *view = viewAt(y, x);
+		if(view == NULL)
+			break;
+		struct appendBuffer *line = &view->lines[y - view->top];
+		if(line->len)
+			appendBufferAppend(ab, line->buffer, line->len);
+		x = view->left + view->columns;
+		if(x < Editor.terminalColumns)		//another view follows, past a separator
+		{
+			int pad = view->columns - view->widths[y - view->top];
+			while(pad-- > 0)
+				appendBufferAppend(ab, " ", 1);
+			appendBufferAppend(ab, "|", 1);
+			x++;
+		}
+	}
+}
+
+//Every view is drawn again in the next frame
+void viewInvalidate()
+{
+	int j;
+	for(j = 0; j < numViews; ++j)
+		views[j].valid = 0;
+}
+
+//Moves the focus to view "at"
+void viewFocus(int at)
+{
+	int other = views[at].buffer != bufferIndex();
+	if(other)
+		bufferLeave();
+	viewSave();
+	focusView = at;
+	viewEnter(at);
+	if(other)
+		bufferResume();
+	Editor.shadowOffset = wrapTopLine();		//not a scroll
+}
+
+//Splits the focused view in two of the same document, stacked or side by side, and focuses the
+//second one
+void editorSplitView(int vertical)
+{
+	struct editorView *view = &views[focusView];
+	if(vertical ? view->columns < VIEW_MIN_COLUMNS * 2 + 1 : view->rows + 1 < (VIEW_MIN_ROWS + 1) * 2)
+	{
+		editorSetStatusMessage("No room to split this view");
+		return;
+	}
+
+	viewSave();
+	int at = viewNew(views[focusView].buffer);
+	views[at].cursorX = views[focusView].cursorX;
+	views[at].cursorY = views[focusView].cursorY;
+	views[at].rowOffset = views[focusView].rowOffset;
+	views[at].columnOffset = views[focusView].columnOffset;
+	views[at].wrapOffset = views[focusView].wrapOffset;
+
+	struct viewNode *node = views[focusView].node;
+	node->first = viewNewNode(focusView, node);
+	node->second = viewNewNode(at, node);
+	node->view = -1;
+	node->vertical = vertical;
+	views[focusView].node = node->first;
+	views[at].node = node->second;
+
+	focusView = at;
+	viewLayout();
+	Editor.shadowOffset = wrapTopLine();
+}
+
+//Goes "delta" views forward, in the order they were opened
+void editorFocusView(int delta)
+{
+	if(numViews == 1)
+	{
+		editorSetStatusMessage("No other view, CTRL W s or v splits this one");
+		return;
+	}
+	viewFocus((focusView + delta % numViews + numViews) % numViews);
+}
+
+//Closes the focused view, the view next to it in the tree takes its place and the focus
+void editorCloseView()
+{
+	if(numViews == 1)
+	{
+		editorSetStatusMessage("The last view can't be closed");
+		return;
+	}
+
+	struct viewNode *node = views[focusView].node;
+	struct viewNode *parent = node->parent;
+	struct viewNode *sibling = parent->first == node ? parent->second : parent->first;
+	struct viewNode *leaf = sibling;
+	while(leaf->view == -1)
+		leaf = leaf->first;
+	int closed = focusView;
+	viewFocus(leaf->view);
+
+	*parent = (struct viewNode) {sibling->view, sibling->vertical, sibling->first, sibling->second, parent->parent};
+	if(parent->view != -1)
+		views[parent->view].node = parent;
+	else
+		parent->first->parent = parent->second->parent = parent;
+	free(sibling);
+	free(node);
+
+	int j;
+	for(j = 0; j < views[closed].numLines; ++j)
+		appendBufferFree(&views[closed].lines[j]);
+	free(views[closed].lines);
+	free(views[closed].widths);
+	memmove(&views[closed], &views[closed + 1], sizeof(struct editorView) * (numViews - closed - 1));
+	numViews--;
+	for(j = 0; j < numViews; ++j)
+		views[j].node->view = j;
+	if(focusView > closed)
+		focusView--;
+	drawnFocus = -1;
+	viewLayout();
+}
+
+//Buffer "at" was closed and the current one took its place in the focused view
+//Other views of it show the current one too, from the top
+void viewBufferClosed(int at)
+{
+	int j;
+	for(j = 0; j < numViews; ++j)
+	{
+		struct editorView *view = &views[j];
+		if(view->buffer == at && j != focusView)
+			*view = (struct editorView) {bufferIndex(), 0, 0, 0, 0, 0, view->top, view->left, view->rows,
+						view->columns, view->node, view->lines, view->widths, view->numLines, 0};
+		else if(view->buffer > at)
+			view->buffer--;
+		view->valid = 0;
+	}
+	views[focusView].buffer = bufferIndex();
+	drawnBuffer = -1;
+}
+
+//CTRL W, then s splits the view into two stacked ones, v side by side, w goes to the next view
+//and c closes it
+void editorViewCommand()
+{
+	editorSetStatusMessage("View: s = split | v = split side by side | w = next | c = close");
+	editorRefreshScreen();
+	int c = editorReadKey();
+	editorSetStatusMessage("");
+
+	switch(c)
+	{
+		case 's':
+			editorSplitView(0);
+			break;
+		case 'v':
+			editorSplitView(1);
+			break;
+		case 'w':
+		case CTRL_KEY('w'):
+			editorFocusView(1);
+			break;
+		case 'c':
+			editorCloseView();
+			break;
+	}
+}
@@ -0,0 +1,469 @@
+#include "editor.h"
+
+#define VIEWER_SIZE ((size_t)256 << 20)		//files from this size on are opened in viewer mode
+#define VIEWER_LINES 1024		//rows in a chunk, and between two marks of the line index
+#define VIEWER_SCAN (4 << 20)		//bytes of the mapping looked at in one go by indexing and search
+#define VIEWER_BUDGET_MS 30		//time spent indexing before the screen is refreshed
+
+//Viewer mode, for files too big to have a row for every line
+//Only a sparse line index is kept, the byte where every VIEWER_LINES-th row starts, and rows are
+//decoded from the mapping a chunk of VIEWER_LINES at a time when editorRowAt() asks for them; the
+//VIEWER_CHUNKS chunks looked at last are kept and the oldest one goes for the next
+//Indexing and search stream through the mapping and drop the pages behind them, so the memory
+//taken stays at a few MB whatever the size of the file
+//The file is read only, keys that would change it are turned away by viewerKey()
+
+size_t viewerThreshold = VIEWER_SIZE;
+
+//Drops the pages of bytes "from" to "to" of the mapping, they are read again when looked at
+void viewerDrop(size_t from, size_t to)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	from -= from % page;
+	to -= to % page;
+	if(to > from)
+		madvise(Editor.map + from, to - from, MADV_DONTNEED);
+}
+
+//Shows the mapped "file" through the viewer, its lines are counted in the background
+void viewerOpen(struct fileCache *file)
+{
+	struct editorViewer *viewer = calloc(1, sizeof(struct editorViewer));
+	if(viewer == NULL)
+		die("calloc");
+	int j;
+	for(j = 0; j < VIEWER_CHUNKS; ++j)
+		viewer->chunks[j].first = -1;
+	viewer->found = -1;
+	viewer->softWrap = Editor.softWrap;
+	viewer->indexing = 1;
+
+	Editor.viewer = viewer;
+	viewerMark(0);
+	Editor.softWrap = 0;
+	Editor.syntax = NULL;		//rows come and go, they are not highlighted
+	Editor.file = file;
+	Editor.map = file->map;
+	Editor.mapSize = file->size;
+	Editor.dirty = 0;
+	madvise(Editor.map, Editor.mapSize, MADV_SEQUENTIAL);
+	editorAddTask(viewerIndexStep);
+	editorSetStatusMessage("%.20s is %zu MB, opened read only in viewer mode", Editor.filename,
+			Editor.mapSize >> 20);
+}
+
+//Frees the viewer of the document being closed, the rows' tabs go with the arena
+void viewerClose()
+{
+	struct editorViewer *viewer = Editor.viewer;
+	if(viewer == NULL)
+		return;
+	editorRemoveTask(viewerIndexStep);
+	int j;
+	for(j = 0; j < VIEWER_CHUNKS; ++j)
+		free(viewer->chunks[j].rows);
+	free(viewer->marks);
+	Editor.softWrap = viewer->softWrap;
+	free(viewer);
+	Editor.viewer = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Index ***///
+//*************///
+
+//Row Editor.numRows starts at byte "at"
+void viewerMark(size_t at)
+{
+	struct editorViewer *viewer = Editor.viewer;
+	if(viewer->numMarks == viewer->marksCapacity)
+	{
+		viewer->marksCapacity = viewer->marksCapacity ? viewer->marksCapacity * 2 : 1024;
+		viewer->marks = realloc(viewer->marks, sizeof(size_t) * viewer->marksCapacity);
+		if(viewer->marks == NULL)
+			die("realloc");
+	}
+	viewer->marks[viewer->numMarks++] = at;
+}
+
+//Counts the rows in up to "limit" more bytes of the mapping
+//Returns the bytes looked at, 0 once every row is counted
+size_t viewerIndex(size_t limit)
+{
+	struct editorViewer *viewer = Editor.viewer;
+	if(!viewer->indexing)
+		return 0;
+
+	char *start = Editor.map + viewer->scanned;
+	char *end = Editor.map + Editor.mapSize;
+	char *stop = (size_t)(end - start) > limit ? start + limit : end;
+	char *p = start;
+	char *newLine;
+	while(p < stop && (newLine = memchr(p, '\n', stop - p)))
+	{
+		p = newLine + 1;
+		viewer->indexed = p - Editor.map;
+		if(++Editor.numRows % VIEWER_LINES == 0 && p < end)
+			viewerMark(viewer->indexed);
+		if(Editor.numRows == INT_MAX - 1)
+			stop = end = p;		//no more rows than an int counts, the rest is not shown
+	}
+	viewerDrop(start - Editor.map, stop - Editor.map);
+	viewer->scanned = stop - Editor.map;
+
+	if(stop == end)
+	{
+		if(viewer->indexed < viewer->scanned)
+			Editor.numRows++;		//the last line has no new line
+		viewer->indexing = 0;
+		madvise(Editor.map, Editor.mapSize, MADV_NORMAL);
+	}
+	return stop - start;
+}
+
+//Counts rows for about VIEWER_BUDGET_MS so the screen can be refreshed in between
+//Returns 1 while there is more to count
+int viewerIndexStep()
+{
+	struct timespec start, now;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while(viewerIndex(VIEWER_SCAN))
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 >= VIEWER_BUDGET_MS)
+			break;
+	}
+	return Editor.viewer->indexing;
+}
+
+//Counts the rows up to byte "at" right away, for a jump or a match past what is counted so far
+void viewerIndexTo(size_t at)
+{
+	while(Editor.viewer->indexing && Editor.viewer->indexed <= at)
+		viewerIndex(VIEWER_SCAN);
+}
+
+//Counts the rows up to row "at" right away
+void viewerIndexRows(int at)
+{
+	while(Editor.viewer->indexing && Editor.numRows <= at)
+		viewerIndex(VIEWER_SCAN);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Rows  ***///
+//*************///
+
+//Decodes the rows of the chunk starting at row "first" into "chunk", over the one it had
+void viewerLoadChunk(struct viewerChunk *chunk, int first)
+{
+	if(chunk->first != -1 && chunk->count)
+	{
+		erow *last = &chunk->rows[chunk->count - 1];
+		size_t from = chunk->rows[0].chars - Editor.map;
+		size_t to = last->chars + last->size - Editor.map;
+		int j;
+		for(j = 0; j < chunk->count; ++j)
+			arenaFree(chunk->rows[j].tabs, sizeof(struct rowTab) * chunk->rows[j].numTabs);
+		viewerDrop(from, to);
+	}
+	if(chunk->rows == NULL)
+	{
+		chunk->rows = malloc(sizeof(erow) * VIEWER_LINES);
+		if(chunk->rows == NULL)
+			die("malloc");
+	}
+
+	char *p = Editor.map + Editor.viewer->marks[first / VIEWER_LINES];
+	char *end = Editor.map + Editor.mapSize;
+	int count = Editor.numRows - first < VIEWER_LINES ? Editor.numRows - first : VIEWER_LINES;
+	int j;
+	for(j = 0; j < count; ++j)
+	{
+		char *newLine = memchr(p, '\n', end - p);
+		size_t len = (newLine ? newLine : end) - p;
+		while(len > 0 && p[len - 1] == '\r')
+			len--;
+		chunk->rows[j] = (erow) {.chars = p, .size = len};
+		p = newLine ? newLine + 1 : end;
+	}
+	chunk->first = first;
+	chunk->count = count;
+}
+
+//Row "at" of the file, decoded when its chunk is not kept
+//The row stays until VIEWER_CHUNKS other chunks were looked at, callers only hold it for a moment
+erow *viewerRow(int at)
+{
+	struct editorViewer *viewer = Editor.viewer;
+	int first = at - at % VIEWER_LINES;
+	struct viewerChunk *chunk = viewer->last;
+	int load = 0;
+	if(chunk == NULL || chunk->first != first)
+	{
+		struct viewerChunk *oldest = &viewer->chunks[0];
+		int j;
+		chunk = NULL;
+		for(j = 0; j < VIEWER_CHUNKS && !chunk; ++j)
+		{
+			if(viewer->chunks[j].first == first)
+				chunk = &viewer->chunks[j];
+			else if(viewer->chunks[j].used < oldest->used)
+				oldest = &viewer->chunks[j];
+		}
+		if(chunk == NULL)
+		{
+			chunk = oldest;
+			load = 1;
+		}
+	}
+	if(load || at - first >= chunk->count)		//not decoded, or counted after the chunk was
+		viewerLoadChunk(chunk, first);
+	chunk->used = ++viewer->clock;
+	viewer->last = chunk;
+	return &chunk->rows[at - first];
+}
+
+//Byte row "at" starts at, the size of the file for Editor.numRows
+long long viewerOffsetOf(int at)
+{
+	if(at >= Editor.numRows)
+		return Editor.mapSize;
+	return viewerRow(at)->chars - Editor.map;
+}
+
+//Row that has byte "offset", Editor.numRows past the end
+//The rows up to there are counted first
+int viewerRowAt(long long offset)
+{
+	struct editorViewer *viewer = Editor.viewer;
+	if(offset >= (long long)Editor.mapSize)
+	{
+		viewerIndexTo(Editor.mapSize);
+		return Editor.numRows;
+	}
+	viewerIndexTo(offset);
+
+	int low = 0, high = viewer->numMarks;		//last mark at or before the offset
+	while(high - low > 1)
+	{
+		int middle = low + (high - low) / 2;
+		if(viewer->marks[middle] <= (size_t)offset)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	int row = low * VIEWER_LINES;
+	char *p = Editor.map + viewer->marks[low];
+	char *at = Editor.map + offset;
+	char *newLine;
+	while((newLine = memchr(p, '\n', at - p)))
+	{
+		p = newLine + 1;
+		row++;
+	}
+	return row;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//** Search  ***///
+//*************///
+
+//First match of "query" that starts from byte "from" up to before "to"
+//Returns its byte, -1 when there is none
+long long viewerMatch(const char *query, int len, size_t from, size_t to)
+{
+	size_t stop = to + len - 1 < Editor.mapSize ? to + len - 1 : Editor.mapSize;
+	if(from >= stop)
+		return -1;
+	const char *match = searchKernel(Editor.map + from, stop - from, query, len);
+	return match ? match - Editor.map : -1;
+}
+
+//Last match of "query" that starts from byte "from" up to before "to"
+long long viewerLastMatch(const char *query, int len, size_t from, size_t to)
+{
+	long long last = -1;
+	long long match;
+	while(from < to && (match = viewerMatch(query, len, from, to)) != -1)
+	{
+		last = match;
+		from = match + 1;
+	}
+	return last;
+}
+
+//Streams through the mapping VIEWER_SCAN bytes at a time for "query", from byte "from" on or,
+//"backward", before it; the search goes around the end of the file and drops the pages behind it
+//Returns the byte of the match, -1 when there is none
+long long viewerSearch(const char *query, int len, size_t from, int backward)
+{
+	size_t size = Editor.mapSize;
+	long long match = -1;
+	size_t at;
+	if(!backward)
+	{
+		for(at = from; match == -1 && at < size; at += VIEWER_SCAN)
+		{
+			match = viewerMatch(query, len, at, at + VIEWER_SCAN < size ? at + VIEWER_SCAN : size);
+			viewerDrop(at, match != -1 ? (size_t)match : at + VIEWER_SCAN < size ? at + VIEWER_SCAN : size);
+		}
+		for(at = 0; match == -1 && at < from; at += VIEWER_SCAN)
+		{
+			match = viewerMatch(query, len, at, at + VIEWER_SCAN < from ? at + VIEWER_SCAN : from);
+			viewerDrop(at, match != -1 ? (size_t)match : at + VIEWER_SCAN < from ? at + VIEWER_SCAN : from);
+		}
+	}
+	else
+	{
+		for(at = from; match == -1 && at > 0; at -= at > VIEWER_SCAN ? VIEWER_SCAN : at)
+		{
+			match = viewerLastMatch(query, len, at > VIEWER_SCAN ? at - VIEWER_SCAN : 0, at);
+			viewerDrop(match != -1 ? (size_t)match : at > VIEWER_SCAN ? at - VIEWER_SCAN : 0, at);
+		}
+		for(at = size; match == -1 && at > from; at -= at - from > VIEWER_SCAN ? VIEWER_SCAN : at - from)
+		{
+			match = viewerLastMatch(query, len, at - from > VIEWER_SCAN ? at - VIEWER_SCAN : from, at);
+			viewerDrop(match != -1 ? (size_t)match : at - from > VIEWER_SCAN ? at - VIEWER_SCAN : from, at);
+		}
+	}
+	return match;
+}
+
+//Called by editorPrompt() after every key, like editorFindCallback() but with one match found at
+//a time: a longer query is looked for from the match of the shorter one, as nothing before it can
+//match, and arrows look for the next and previous match
+void viewerFindCallback(char *query, int key)
+{
+	struct editorViewer *viewer = Editor.viewer;
+	struct editorSearch *search = &Editor.search;
+
+	if(key == '\x1b' || (key == '\r' && query[0]))	//the prompt is closing
+	{
+		searchClear();
+		return;
+	}
+
+	int len = strlen(query);
+	int previous = search->query.len;
+	if(len != previous || memcmp(query, search->query.buffer, len) != 0)
+	{
+		if(len == 0)
+			viewer->found = -1;
+		else if(previous && len > previous && memcmp(query, search->query.buffer, previous) == 0)
+			viewer->found = viewer->found == -1 ? -1 : viewerSearch(query, len, viewer->found, 0);
+		else
+			viewer->found = viewerSearch(query, len, viewer->origin, 0);
+		appendBufferReset(&search->query);
+		appendBufferAppend(&search->query, query, len);
+	}
+	else if(viewer->found != -1 && (key == ARROW_RIGHT || key == ARROW_DOWN))
+		viewer->found = viewerSearch(query, len, viewer->found + 1, 0);
+	else if(viewer->found != -1 && (key == ARROW_LEFT || key == ARROW_UP))
+		viewer->found = viewerSearch(query, len, viewer->found, 1);
+	else
+		return;
+
+	search->numMatches = 0;
+	if(viewer->found == -1)
+		return;
+	int row = viewerRowAt(viewer->found);
+	int col = viewer->found - viewerOffsetOf(row);
+	searchAddMatch(row, col, len);
+	search->current = 0;
+	search->rows = Editor.numRows;
+	Editor.cursorY = row;
+	Editor.cursorX = col;
+	Editor.rowOffset = Editor.numRows;
+}
+
+//CTRL F in viewer mode, plain text only
+void viewerFind()
+{
+	int savedCursorX = Editor.cursorX;
+	int savedCursorY = Editor.cursorY;
+	int savedColumnOff = Editor.columnOffset;
+	int savedRowOff = Editor.rowOffset;
+
+	searchClear();
+	Editor.search.active = 1;
+	Editor.viewer->found = -1;
+	Editor.viewer->origin = viewerOffsetOf(Editor.cursorY) + (Editor.cursorY < Editor.numRows ? Editor.cursorX : 0);
+	if(Editor.viewer->origin >= Editor.mapSize)
+		Editor.viewer->origin = 0;
+
+	char *query = editorPrompt("Search: %s (arrows for the next and previous, ESC to cancel)",
+				viewerFindCallback, 0);
+	if(query)
+		free(query);
+	else
+	{
+		Editor.cursorX = savedCursorX;
+		Editor.cursorY = savedCursorY;
+		Editor.columnOffset = savedColumnOff;
+		Editor.rowOffset = savedRowOff;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//*************///
+//*** Keys  ***///
+//*************///
+
+//Turns away the keys that would change the file or need every row of it
+//Returns 1 when "c" was taken care of here
+int viewerKey(int c)
+{
+	if(Editor.viewer->indexing)
+		editorAddTask(viewerIndexStep);		//stopped while another document had the focus
+
+	switch(c)
+	{
+		case CTRL_KEY('f'):
+			viewerFind();
+			return 1;
+		case CTRL_KEY('e'):
+			editorSetStatusMessage("No regex search in viewer mode, CTRL F looks for plain text");
+			return 1;
+		case CTRL_KEY('u'):
+			editorSetStatusMessage("Soft wrap is off in viewer mode");
+			return 1;
+		case CTRL_KEY('q'):
+		case CTRL_KEY('o'):
+		case CTRL_KEY('k'):
+		case CTRL_KEY('n'):
+		case CTRL_KEY('p'):
+		case CTRL_KEY('w'):
+		case CTRL_KEY('t'):
+		case CTRL_KEY('g'):
+		case CTRL_KEY('l'):
+		case HOME_KEY:
+		case END_KEY:
+		case PAGE_UP:
+		case PAGE_DOWN:
+		case ARROW_RIGHT:
+		case ARROW_DOWN:
+		case ARROW_LEFT:
+		case ARROW_UP:
+		case '\x1b':
+			return 0;
+		default:
+			editorSetStatusMessage("%.20s is read only in viewer mode", Editor.filename);
+			return 1;
+	}
+}
+
+//Right side of the status bar, where the cursor is in bytes and how far counting the rows got
+int viewerStatus(char *status, size_t size)
+{
+	if(Editor.viewer->indexing)
+		return snprintf(status, size, "indexing %d%% | %d/%d lines",
+					(int)(Editor.viewer->scanned * 100 / Editor.mapSize), Editor.cursorY + 1, Editor.numRows);
+	long long at = viewerOffsetOf(Editor.cursorY) + (Editor.cursorY < Editor.numRows ? Editor.cursorX : 0);
+	return snprintf(status, size, "byte %lld/%zu | %d/%d lines", at, Editor.mapSize,
+				Editor.cursorY + 1, Editor.numRows);
+}
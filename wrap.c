@@ -0,0 +1,307 @@
+#include "editor.h"
+
+//Soft wrap, CTRL U, rows longer than the view go on over the lines below it
+//Every slot of Editor.row has the number of lines its row takes, 0 in the gap, and a Fenwick tree
+//over those counts gives the line a row starts on and the row under a line in O(log n)
+//The counts follow the gap as it moves and are changed one row at a time as rows are edited, so
+//scrolling, paging and drawing never walk the rows above the screen
+//The counts are for one text width, a document keeps them for WRAP_WIDTHS widths so views of it
+//side by side do not count its rows again in every frame
+
+//Lines of text the row takes at "columns" a line, there is always room for the cursor after it
+int wrapRowHeight(erow *row, int columns)
+{
+	int width = 0;
+	const char *p = row->chars;
+	const char *end = row->chars + row->size;
+	const char *tab;
+	while(row->size && (tab = memchr(p, '\t', end - p)))
+	{
+		width += tab - p;
+		width += TAB_SIZE - width % TAB_SIZE;
+		p = tab + 1;
+	}
+	width += end - p;
+	return width / columns + 1;
+}
+
+//Columns of text a line of the view shows
+int wrapColumns()
+{
+	int columns = Editor.screenColumns;
+	if(Editor.typeLineNumber != -1)
+		columns -= strlen(itoa(Editor.numRows, 10));
+	return columns > 0 ? columns : 1;
+}
+
+//Counts for the width of the view drawn now, see wrapPrepare()
+struct editorWrap *wrapCurrent()
+{
+	return &Editor.wrap[Editor.wrapUsed];
+}
+
+void wrapAdd(struct editorWrap *wrap, int slot, int delta)
+{
+	for(slot++; slot <= wrap->size; slot += slot & -slot)
+		wrap->tree[slot] += delta;
+}
+
+//Builds the tree over the counts in O(n)
+void wrapBuildTree(struct editorWrap *wrap)
+{
+	int j;
+	wrap->tree = realloc(wrap->tree, sizeof(int) * (wrap->size + 1));
+	if(wrap->tree == NULL)
+		die("realloc");
+	wrap->tree[0] = 0;
+	memcpy(&wrap->tree[1], wrap->heights, sizeof(int) * wrap->size);
+	for(j = 1; j <= wrap->size; ++j)
+		if(j + (j & -j) <= wrap->size)
+			wrap->tree[j + (j & -j)] += wrap->tree[j];
+}
+
+//Picks the counts for the width of the view in Editor, the rows are counted when there are none
+//Returns that width
+int wrapPrepare()
+{
+	int columns = wrapColumns();
+	int j;
+	for(j = 0; j < WRAP_WIDTHS; ++j)
+	{
+		if(Editor.wrap[j].columns == columns)
+		{
+			Editor.wrapUsed = j;
+			return columns;
+		}
+	}
+	for(j = 0; j < WRAP_WIDTHS - 1 && Editor.wrap[j].columns; ++j)
+		;
+	if(Editor.wrap[j].columns)		//every one is taken, the one after the last used goes
+		j = (Editor.wrapUsed + 1) % WRAP_WIDTHS;
+	Editor.wrapUsed = j;
+
+	struct editorWrap *wrap = wrapCurrent();
+	wrap->columns = columns;
+	wrap->size = Editor.numRows + Editor.rowGapLen;
+	wrap->heights = realloc(wrap->heights, sizeof(int) * (wrap->size ? wrap->size : 1));
+	if(wrap->heights == NULL)
+		die("realloc");
+	for(j = 0; j < wrap->size; ++j)
+		wrap->heights[j] = j >= Editor.rowGap && j < Editor.rowGap + Editor.rowGapLen ? 0 :
+				wrapRowHeight(&Editor.row[j], columns);
+	wrapBuildTree(wrap);
+	return columns;
+}
+
+//Drops the counts, they are only built again when the document is drawn wrapped
+void wrapReset()
+{
+	int j;
+	for(j = 0; j < WRAP_WIDTHS; ++j)
+	{
+		struct editorWrap *wrap = &Editor.wrap[j];
+		free(wrap->heights);
+		free(wrap->tree);
+		wrap->heights = NULL;
+		wrap->tree = NULL;
+		wrap->size = 0;
+		wrap->columns = 0;
+	}
+}
+
+//Sets the counts of slot "slot" of Editor.row to the lines of "row", 0 for NULL
+void wrapSet(int slot, erow *row)
+{
+	int j;
+	for(j = 0; j < WRAP_WIDTHS; ++j)
+	{
+		struct editorWrap *wrap = &Editor.wrap[j];
+		if(wrap->columns == 0)
+			continue;
+		int lines = row ? wrapRowHeight(row, wrap->columns) : 0;
+		if(wrap->heights[slot] != lines)
+		{
+			wrapAdd(wrap, slot, lines - wrap->heights[slot]);
+			wrap->heights[slot] = lines;
+		}
+	}
+}
+
+//The text of the row changed
+void wrapUpdateRow(erow *row)
+{
+	wrapSet(row - Editor.row, row);
+}
+
+//editorMoveGap() is about to move the gap to "at", the counts go along with the rows
+void wrapMoveGap(int at)
+{
+	int k;
+	for(k = 0; k < WRAP_WIDTHS; ++k)
+	{
+		if(Editor.wrap[k].columns && at != Editor.rowGap)
+			wrapMoveSlots(&Editor.wrap[k], at);
+	}
+}
+
+//A long move builds the tree again instead of moving the rows through it one by one
+void wrapMoveSlots(struct editorWrap *wrap, int at)
+{
+	int from = at < Editor.rowGap ? at : Editor.rowGap + Editor.rowGapLen;
+	int to = at < Editor.rowGap ? at + Editor.rowGapLen : Editor.rowGap;
+	int count = at < Editor.rowGap ? Editor.rowGap - at : at - Editor.rowGap;
+	int rebuild = count > wrap->size / 32;		//about what the updates of two slots a row cost
+	int j;
+	if(!rebuild)
+	{
+		for(j = 0; j < count; ++j)
+		{
+			wrapAdd(wrap, from + j, -wrap->heights[from + j]);
+			wrapAdd(wrap, to + j, wrap->heights[from + j]);
+		}
+	}
+	memmove(&wrap->heights[to], &wrap->heights[from], sizeof(int) * count);
+	memset(&wrap->heights[at], 0, sizeof(int) * Editor.rowGapLen);
+	if(rebuild)
+		wrapBuildTree(wrap);
+}
+
+//editorGrowGap() is about to make Editor.row "capacity" slots long, with the rows after the gap
+//moved to the end
+void wrapGrowGap(int capacity)
+{
+	int j;
+	for(j = 0; j < WRAP_WIDTHS; ++j)
+	{
+		struct editorWrap *wrap = &Editor.wrap[j];
+		if(wrap->columns == 0)
+			continue;
+		int tail = wrap->size - Editor.rowGap - Editor.rowGapLen;
+		wrap->heights = realloc(wrap->heights, sizeof(int) * capacity);
+		if(wrap->heights == NULL)
+			die("realloc");
+		memmove(&wrap->heights[capacity - tail], &wrap->heights[Editor.rowGap + Editor.rowGapLen],
+				sizeof(int) * tail);
+		memset(&wrap->heights[Editor.rowGap], 0, sizeof(int) * (capacity - tail - Editor.rowGap));
+		wrap->size = capacity;
+		wrapBuildTree(wrap);
+	}
+}
+
+//Line row "at" starts on, the lines of every row for Editor.numRows
+int wrapLineOf(int at)
+{
+	struct editorWrap *wrap = wrapCurrent();
+	int slot = at >= Editor.rowGap ? at + Editor.rowGapLen : at;
+	int line = 0;
+	for(; slot > 0; slot -= slot & -slot)
+		line += wrap->tree[slot];
+	return line;
+}
+
+//Row that has line "line" and the line of the row it is in "segment"
+//Past the last row it is Editor.numRows, the line after the file
+int wrapRowAt(int line, int *segment)
+{
+	struct editorWrap *wrap = wrapCurrent();
+	int slot = 0;
+	int bit = 1;
+	while(bit * 2 <= wrap->size)
+		bit *= 2;
+	for(; bit; bit /= 2)
+	{
+		if(slot + bit <= wrap->size && wrap->tree[slot + bit] <= line)
+		{
+			slot += bit;
+			line -= wrap->tree[slot];
+		}
+	}
+	*segment = line;
+	if(slot >= wrap->size)
+		return Editor.numRows;
+	return slot >= Editor.rowGap + Editor.rowGapLen ? slot - Editor.rowGapLen : slot;
+}
+
+//Line at the top of the view, with soft wrap off the row there
+int wrapTopLine()
+{
+	if(!Editor.softWrap)
+		return Editor.rowOffset;
+	wrapPrepare();
+	return wrapLineOf(Editor.rowOffset) + Editor.wrapOffset;
+}
+
+//Line the cursor is on
+int wrapCursorLine()
+{
+	int columns = wrapPrepare();
+	if(Editor.cursorY >= Editor.numRows)
+		return wrapLineOf(Editor.numRows);
+	return wrapLineOf(Editor.cursorY) + editorRowCursorXToRowX(editorRowAt(Editor.cursorY), Editor.cursorX) / columns;
+}
+
+//Where the cursor is in the view, for editorRefreshScreen()
+void wrapCursor(int *y, int *x)
+{
+	int columns = wrapPrepare();
+	*y = wrapLineOf(Editor.cursorY) + Editor.rowX / columns - wrapTopLine();
+	*x = Editor.rowX % columns;
+}
+
+//Scrolls the view so the line of the cursor is on it, Editor.rowX is up to date
+void wrapScroll()
+{
+	int columns = wrapPrepare();
+	if(Editor.rowOffset >= Editor.numRows)
+	{
+		Editor.rowOffset = Editor.numRows;
+		Editor.wrapOffset = 0;
+	}
+	else if(Editor.wrapOffset >= wrapCurrent()->heights[editorRowAt(Editor.rowOffset) - Editor.row])
+		Editor.wrapOffset = wrapCurrent()->heights[editorRowAt(Editor.rowOffset) - Editor.row] - 1;	//the row got shorter
+
+	int top = wrapLineOf(Editor.rowOffset) + Editor.wrapOffset;
+	int cursor = wrapLineOf(Editor.cursorY) + Editor.rowX / columns;
+	if(cursor < top)
+		top = cursor;
+	if(cursor >= top + Editor.screenRows)
+		top = cursor - Editor.screenRows + 1;
+	Editor.rowOffset = wrapRowAt(top, &Editor.wrapOffset);
+	Editor.columnOffset = 0;
+}
+
+//Moves the cursor to line "line", at the column it has in the line it is on
+void wrapMoveCursor(int line)
+{
+	int columns = wrapPrepare();
+	int column = Editor.cursorY < Editor.numRows ?
+			editorRowCursorXToRowX(editorRowAt(Editor.cursorY), Editor.cursorX) % columns : 0;
+	int last = wrapLineOf(Editor.numRows);
+	if(line > last)
+		line = last;
+	if(line < 0)
+		line = 0;
+
+	int segment;
+	Editor.cursorY = wrapRowAt(line, &segment);
+	Editor.cursorX = 0;
+	if(Editor.cursorY == Editor.numRows)
+		return;
+	erow *row = editorRowAt(Editor.cursorY);
+	Editor.cursorX = editorRowRenderXToCursorX(row, segment * columns + column);
+	if(Editor.cursorX < row->size && editorRowCursorXToRowX(row, Editor.cursorX) < segment * columns)
+		Editor.cursorX++;		//on a tab that starts on the line before
+}
+
+//CTRL U, turns soft wrap on or off for every view
+void editorToggleWrap()
+{
+	Editor.softWrap = !Editor.softWrap;
+	if(!Editor.softWrap)
+		wrapReset();
+	Editor.wrapOffset = 0;
+	Editor.columnOffset = 0;
+	Editor.shadowOffset = wrapTopLine();		//not a scroll
+	viewInvalidate();
+	editorSetStatusMessage(Editor.softWrap ? "Soft wrap on" : "Soft wrap off");
+}